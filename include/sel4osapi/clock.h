@@ -13,6 +13,56 @@
 #define SEL4OSAPI_CLOCK_H_
 
 #define SEL4OSAPI_SYSCLOCK_MAX_ENTRIES  100
+#define SEL4OSAPI_SYSCLOCK_MAX_NOTIFIERS    SEL4OSAPI_SYSCLOCK_MAX_ENTRIES
+/*
+ * Maximum number of requests in a batch (limited by
+ * the number of message registers).
+ */
+#define SEL4OSAPI_SYSCLOCK_MAX_BATCH        16
+
+/*
+ * Histograms kept by the sysclock:
+ *  - LATENESS: how late each timeout is signaled after its
+ *    expiration time, in microseconds
+ *  - PROCESSING: time spent by sysclock::timer handling
+ *    each tick (or interrupt, in tickless mode), in microseconds
+ *  - OCCUPANCY: number of pending timeouts at each tick
+ */
+#define SEL4OSAPI_SYSCLOCK_HISTOGRAM_LATENESS       0
+#define SEL4OSAPI_SYSCLOCK_HISTOGRAM_PROCESSING     1
+#define SEL4OSAPI_SYSCLOCK_HISTOGRAM_OCCUPANCY      2
+#define SEL4OSAPI_SYSCLOCK_HISTOGRAMS               3
+
+#define SEL4OSAPI_SYSCLOCK_HISTOGRAM_BUCKETS        20
+
+/*
+ * Histogram with power-of-two buckets: bucket 0 counts
+ * zeros, bucket i counts values in [2^(i-1), 2^i), and
+ * the last bucket also counts all larger values.
+ */
+typedef struct sel4osapi_sysclock_histogram
+{
+    uint32_t count;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t buckets[SEL4OSAPI_SYSCLOCK_HISTOGRAM_BUCKETS];
+} sel4osapi_sysclock_histogram_t;
+
+/*
+ * Page where the sysclock publishes the current time. It is
+ * mapped read-only into every user process, so that reading
+ * the time does not require a call to the sysclock's server.
+ *
+ * The page is updated by sysclock::timer only, under a seqlock:
+ * 'seq' is odd while an update is in progress, and readers must
+ * retry until they observe the same even value before and after
+ * reading the other fields.
+ */
+typedef struct sel4osapi_sysclock_time_page
+{
+    uint32_t seq;
+    uint32_t time;
+} sel4osapi_sysclock_time_page_t;
 
 /*
  * Type representing the system clock. Not meant to
@@ -36,12 +86,62 @@ typedef struct sel4osapi_sysclock
     vka_object_t timer_aep;
     sel4osapi_thread_t *server_thread;
     vka_object_t server_ep_obj;
+    /*
+     * Thread and endpoint serving time queries only.
+     */
+    sel4osapi_thread_t *time_thread;
+    vka_object_t time_ep_obj;
     sel4osapi_mutex_t *timeouts_mutex;
+    /*
+     * Serializes the calls into the hardware timer, so that time
+     * queries do not wait for the timeouts mutex. Taken after the
+     * timeouts mutex, when both are held.
+     */
+    sel4osapi_mutex_t *timer_mutex;
 
     /*simple_list_t *timeouts;
     simple_list_t *free_entries;*/
 
     simple_pool_t *schedule;
+    /*
+     * Pending timeouts (allocated from the schedule), ordered
+     * as a binary min-heap on the time of their next event.
+     */
+    struct timeout_entry **timeouts;
+    int timeouts_num;
+    /*
+     * Maps timeout ids to pending timeouts.
+     */
+    simple_handle_table_t *timeout_ids;
+    /*
+     * Notifications registered by client threads, and the
+     * ids that their timeouts refer to them by.
+     */
+    simple_pool_t *notifiers;
+    simple_handle_table_t *notifier_ids;
+    /*
+     * Protected by the timeouts mutex.
+     */
+    sel4osapi_sysclock_histogram_t histograms[SEL4OSAPI_SYSCLOCK_HISTOGRAMS];
+    /*
+     * Shared time page (NULL in tickless mode, where the time
+     * only advances when the hardware timer's counter is read).
+     */
+    sel4osapi_sysclock_time_page_t *time_page;
+
+    /*
+     * Value of the hardware timer's counter at time 0 (in periodic
+     * mode, when the timer thread starts ticking).
+     */
+    uint64_t time_base_ns;
+
+#if SEL4OSAPI_SYSCLOCK_TICKLESS
+    /*
+     * Tickless mode: next_event the timer is armed for.
+     */
+    int armed;
+    seL4_Uint32 armed_event;
+#endif
 
 } sel4osapi_sysclock_t;
 
@@ -65,17 +165,171 @@ sel4osapi_sysclock_start(sel4osapi_sysclock_t *sysclock);
  * Return the current system time in milliseconds.
  *
  * The time is relative to time when the sysclock was started.
+ * It is read from the shared time page if the process has one
+ * mapped, otherwise it is requested from the sysclock's server.
  */
 uint32_t
 sel4osapi_sysclock_get_time();
 
+/*
+ * Return the current system time in nanoseconds, as read
+ * from the hardware timer's counter by the sysclock's server.
+ *
+ * Unlike sel4osapi_sysclock_get_time(), the value does not
+ * advance in steps of SEL4OSAPI_SYSCLOCK_PERIOD_MS and does
+ * not wrap around.
+ */
+uint64_t
+sel4osapi_sysclock_get_time_ns();
+
+/*
+ * Read the CPU's cycle counter, if the architecture lets
+ * user level read it (SEL4OSAPI_SYSCLOCK_HAS_CYCLES is 1).
+ * Otherwise, return 0.
+ *
+ * Cycles are not converted to time: they are only meant to
+ * measure short intervals on the same CPU.
+ */
+#if defined(__i386__) || defined(__x86_64__)
+#define SEL4OSAPI_SYSCLOCK_HAS_CYCLES   1
+static inline uint64_t
+sel4osapi_sysclock_get_cycles(void)
+{
+    uint32_t lo, hi;
+    __asm__ __volatile__("rdtsc" : "=a" (lo), "=d" (hi));
+    return ((uint64_t) hi << 32) | lo;
+}
+#elif defined(__aarch64__)
+#define SEL4OSAPI_SYSCLOCK_HAS_CYCLES   1
+static inline uint64_t
+sel4osapi_sysclock_get_cycles(void)
+{
+    uint64_t cycles;
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r" (cycles));
+    return cycles;
+}
+#elif defined(__arm__) && defined(CONFIG_EXPORT_PMU_USER)
+#define SEL4OSAPI_SYSCLOCK_HAS_CYCLES   1
+static inline uint64_t
+sel4osapi_sysclock_get_cycles(void)
+{
+    uint32_t cycles;
+    /* PMCCNTR, 32 bits wide */
+    __asm__ __volatile__("mrc p15, 0, %0, c9, c13, 0" : "=r" (cycles));
+    return cycles;
+}
+#else
+#define SEL4OSAPI_SYSCLOCK_HAS_CYCLES   0
+static inline uint64_t
+sel4osapi_sysclock_get_cycles(void)
+{
+    return 0;
+}
+#endif
+
+/*
+ * Schedule a timeout whose first event is due at the absolute
+ * time deadline_ms (in sysclock milliseconds). A deadline which
+ * has already passed expires on the next tick.
+ *
+ * Periodic timeouts then expire every period_ms after the deadline:
+ * each event is scheduled from the previous deadline, rather than
+ * from the time it was signaled, so the schedule does not drift.
+ * Activations that are already in the past when rescheduling are
+ * skipped.
+ */
+seL4_Word
+sel4osapi_sysclock_schedule_timeout_at(
+        seL4_Bool periodic, seL4_Uint32 deadline_ms, seL4_Uint32 period_ms, seL4_CPtr callback_aep);
+
+/*
+ * Register a notification with the sysclock, which keeps a copy of
+ * the cap and signals it when timeouts referring to it expire.
+ * Returns the notifier's id, or 0 on failure.
+ *
+ * sel4osapi_sysclock_schedule_timeout() registers the calling thread's
+ * AEP on first use, so that later timeouts need no cap transfer.
+ */
+seL4_Word
+sel4osapi_sysclock_register_notifier(seL4_CPtr aep);
+
+/*
+ * Release a notifier, cancelling all its pending timeouts.
+ */
+int
+sel4osapi_sysclock_unregister_notifier(seL4_Word notifier_id);
+
 seL4_Word
 sel4osapi_sysclock_schedule_timeout(
         seL4_Bool periodic, seL4_Uint32 timeout_ms, seL4_CPtr callback_aep);
 
+/*
+ * Schedule a timeout which may expire up to slack_ms milliseconds
+ * late. The sysclock uses the slack to round the timeout's expiration
+ * to a coarser boundary, so that timeouts with overlapping windows
+ * expire on the same tick and are signaled in the same pass.
+ */
+seL4_Word
+sel4osapi_sysclock_schedule_timeout_slack(
+        seL4_Bool periodic, seL4_Uint32 timeout_ms, seL4_Uint32 slack_ms, seL4_CPtr callback_aep);
+
 int
 sel4osapi_sysclock_cancel_timeout(seL4_Word timeout_id);
 
+#define SEL4OSAPI_SYSCLOCK_REQUEST_SET      0
+#define SEL4OSAPI_SYSCLOCK_REQUEST_CANCEL   1
+
+/*
+ * A timeout request, to be submitted in a batch.
+ */
+typedef struct sel4osapi_sysclock_request
+{
+    /*
+     * SEL4OSAPI_SYSCLOCK_REQUEST_SET or SEL4OSAPI_SYSCLOCK_REQUEST_CANCEL
+     */
+    int type;
+    /*
+     * SET only: the timeout's first event is due time_ms from now,
+     * or at time time_ms if absolute. Periodic timeouts then expire
+     * every period_ms (relative timeouts: time_ms, if period_ms is 0).
+     */
+    seL4_Bool periodic;
+    seL4_Bool absolute;
+    seL4_Uint32 time_ms;
+    seL4_Uint32 period_ms;
+    seL4_Uint32 slack_ms;
+    seL4_CPtr callback_aep;
+    /*
+     * CANCEL: timeout to cancel. SET: id of the new timeout (output).
+     */
+    seL4_Word timeout_id;
+    /*
+     * Output: 0 if the request succeeded.
+     */
+    int error;
+} sel4osapi_sysclock_request_t;
+
+/*
+ * Submit up to SEL4OSAPI_SYSCLOCK_MAX_BATCH requests to the sysclock
+ * in a single call, e.g. to cancel a timeout and schedule the next one.
+ * Requests are served in order. Returns the number of failed requests.
+ */
+int
+sel4osapi_sysclock_submit(sel4osapi_sysclock_request_t *requests, int num);
+
+/*
+ * Copy one of the sysclock's histograms (SEL4OSAPI_SYSCLOCK_HISTOGRAM_*),
+ * optionally resetting it.
+ */
+void
+sel4osapi_sysclock_get_histogram(int which, seL4_Bool reset, sel4osapi_sysclock_histogram_t *histogram_out);
+
+/*
+ * Log all the sysclock's histograms.
+ */
+void
+sel4osapi_sysclock_print_histograms(void);
+
 seL4_Uint32
 sel4osapi_sysclock_wait_for_timeout(seL4_Word timeout_id, seL4_CPtr callback_aep, seL4_Bool cancel);
 
@@ -82,10 +82,56 @@
  */
 #define SEL4OSAPI_THREAD_NAME_MAX_LEN                   CONFIG_LIB_OSAPI_THREAD_MAX_NAME
 
+/*
+ * Number of pages reserved in a process' vspace
+ * for the size classes of its heap.
+ *
+ * Default: 1024 (4MB)
+ */
+#define SEL4OSAPI_HEAP_PAGES                            CONFIG_LIB_OSAPI_HEAP_PAGES
+
 /*
  * Period, in milliseconds, at which the sysclock's
  * time should be updated.
  */
 #define SEL4OSAPI_SYSCLOCK_PERIOD_MS                    CONFIG_LIB_OSAPI_SYSCLOCK_PERIOD
 
+/*
+ * Whether the sysclock runs tickless, i.e. it only takes
+ * an interrupt when the earliest pending timeout is due.
+ */
+#ifdef CONFIG_LIB_OSAPI_SYSCLOCK_TICKLESS
+#define SEL4OSAPI_SYSCLOCK_TICKLESS                     1
+#else
+#define SEL4OSAPI_SYSCLOCK_TICKLESS                     0
+#endif
+
+/*
+ * Maximum number of timers which can be scheduled at
+ * the same time with the timer service of a process.
+ */
+#define SEL4OSAPI_TIMER_SERVICE_MAX_TIMERS              CONFIG_LIB_OSAPI_TIMER_SERVICE_MAX_TIMERS
+
+/*
+ * Whether log messages are queued in a ring, and written
+ * to the console by a background thread.
+ */
+#ifdef CONFIG_LIB_OSAPI_LOG_ASYNC
+#define SEL4OSAPI_LOG_ASYNC                             1
+
+/*
+ * Number of log messages which can be queued (a power of two),
+ * and maximum length of each of them.
+ */
+#define SEL4OSAPI_LOG_RING_LINES                        CONFIG_LIB_OSAPI_LOG_RING_LINES
+#define SEL4OSAPI_LOG_LINE_MAX                          CONFIG_LIB_OSAPI_LOG_LINE_MAX
+
+/*
+ * Priority of the thread which writes queued log messages.
+ */
+#define SEL4OSAPI_LOG_DRAIN_PRIORITY                    CONFIG_LIB_OSAPI_LOG_DRAIN_PRIORITY
+#else
+#define SEL4OSAPI_LOG_ASYNC                             0
+#endif
+
 #endif /* SEL4OSAPI_CONFIG_H_ */
@@ -0,0 +1,105 @@
+/*
+ * FILE: handle.h - generation-counted handle table
+ *
+ * Copyright (c) 2015, Real-Time Innovations, Inc. All rights reserved.
+ *
+ * This software may be distributed and modified according to the terms of
+ * the BSD 2-Clause license. Note that NO WARRANTY is provided.
+ * See "LICENSE_BSD2.txt" for details.
+ *
+ */
+
+#ifndef SEL4OSAPI_HANDLE_H_
+#define SEL4OSAPI_HANDLE_H_
+
+/*
+ * A handle packs a slot index (plus one) in its lower
+ * SIMPLE_HANDLE_INDEX_BITS bits, and the slot's generation
+ * in the bits above. The generation of a slot is incremented
+ * every time the slot is released, so that a stale handle
+ * never resolves to the slot's new owner.
+ *
+ * Handles are always positive. 0 is never a valid handle.
+ */
+#define SIMPLE_HANDLE_INVALID           0
+#define SIMPLE_HANDLE_INDEX_BITS        16
+#define SIMPLE_HANDLE_INDEX_MASK        ((1 << SIMPLE_HANDLE_INDEX_BITS) - 1)
+#define SIMPLE_HANDLE_GEN_MASK          0x7fff
+
+#define SIMPLE_HANDLE(gen_, index_) \
+    ((int) ((((gen_) & SIMPLE_HANDLE_GEN_MASK) << SIMPLE_HANDLE_INDEX_BITS) | ((index_) + 1)))
+#define SIMPLE_HANDLE_INDEX(handle_) \
+    ((int) ((handle_) & SIMPLE_HANDLE_INDEX_MASK) - 1)
+#define SIMPLE_HANDLE_GEN(handle_) \
+    (((handle_) >> SIMPLE_HANDLE_INDEX_BITS) & SIMPLE_HANDLE_GEN_MASK)
+
+/*
+ * Dense table mapping handles to objects.
+ *
+ * The table does not perform any locking: concurrent
+ * users must serialize access with a mutex of their own.
+ */
+typedef struct simple_handle_table
+{
+    int size;
+    int current_size;
+    /*
+     * Object stored in each slot (NULL if the slot is free)
+     */
+    void **objs;
+    /*
+     * Current generation of each slot
+     */
+    uint16_t *gens;
+    /*
+     * Stack of free slot indices
+     */
+    int *free_slots;
+    int free_slots_num;
+    /*
+     * Position of each slot in the free stack (-1 if the
+     * slot is in use), so that simple_handle_insert() can
+     * take any slot off the stack in constant time
+     */
+    int *free_pos;
+} simple_handle_table_t;
+
+/*
+ * Create a new handle table with room for 'size' objects.
+ */
+simple_handle_table_t*
+simple_handle_table_new(int size);
+
+/*
+ * Store an object in a free slot of the table.
+ * Returns the object's handle, or SIMPLE_HANDLE_INVALID if the table is full.
+ */
+int
+simple_handle_alloc(simple_handle_table_t *table, void *obj);
+
+/*
+ * Store an object in the table under a handle which was assigned
+ * by another table (e.g. by a server, on behalf of a client).
+ * Returns 0 on success, -1 if the handle's slot is in use.
+ */
+int
+simple_handle_insert(simple_handle_table_t *table, int handle, void *obj);
+
+/*
+ * Resolve a handle in constant time.
+ * Returns NULL if the handle is invalid or stale.
+ */
+void*
+simple_handle_lookup(simple_handle_table_t *table, int handle);
+
+/*
+ * Release a handle. Its slot can be reused, with a new generation.
+ * Returns 0 on success, -1 if the handle is invalid or stale.
+ */
+int
+simple_handle_free(simple_handle_table_t *table, int handle);
+
+int
+simple_handle_table_get_current_size(simple_handle_table_t *table);
+
+#endif /* SEL4OSAPI_HANDLE_H_ */
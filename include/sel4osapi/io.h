@@ -30,12 +30,47 @@ sel4osapi_io_initialize(ps_io_ops_t *io_ops);
 #define SEL4OSAPI_SERIAL_BUF_SIZE       1 << 12
 #define SEL4OSAPI_SERIAL_BUF_PAGES      (SEL4OSAPI_SERIAL_BUF_SIZE/PAGE_SIZE_4K)
 
+/*
+ * Size of the ring through which a client streams the data
+ * it writes to the server (must be a power of two), and
+ * maximum size of a single record in the ring.
+ */
+#define SEL4OSAPI_SERIAL_RING_SIZE          (1 << 13)
+#define SEL4OSAPI_SERIAL_RING_MAX_RECORD    1024
+
+/*
+ * Size of the receive ring of a serial port (must be a power of two).
+ */
+#define SEL4OSAPI_SERIAL_RX_RING_SIZE   (1 << 10)
+
+/*
+ * Size of the transmit ring of a serial port (must be a power of two).
+ */
+#define SEL4OSAPI_SERIAL_TX_RING_SIZE   (1 << 12)
+
+/*
+ * Ticket passed to sel4osapi_io_serial_flush to wait for
+ * all the bytes queued so far.
+ */
+#define SEL4OSAPI_SERIAL_FLUSH_ALL      ((uint32_t) -1)
+
+/*
+ * Value of a ring's read_len while the client's read is pending.
+ */
+#define SEL4OSAPI_SERIAL_READ_PENDING   ((uint32_t) -1)
+
 typedef enum sel4osapi_serialdevice
 {
     SERIAL_DEV_UART1 = 1,
     SERIAL_DEV_UART2 = 2
 } sel4osapi_serialdevice_t;
 
+/*
+ * Number of serial ports, and index of a device's port.
+ */
+#define SEL4OSAPI_SERIAL_PORTS          2
+#define SEL4OSAPI_SERIAL_PORT_INDEX(dev_)   ((int) (dev_) - SERIAL_DEV_UART1)
+
 typedef struct sel4osapi_serial_config {
     long bps;
     int  char_size;
@@ -43,22 +78,212 @@ typedef struct sel4osapi_serial_config {
     int  stop_bit;
 } sel4osapi_serial_config_t;
 
-typedef struct sel4osapi_serialclient
+/*
+ * Single-producer, single-consumer ring shared by a client (the
+ * producer) and a port's server thread (the consumer). It carries
+ * records made of a sel4osapi_serial_record_t header followed by
+ * the data to write, padded to 4 bytes.
+ */
+typedef struct sel4osapi_serial_ring
+{
+    /*
+     * Advanced by the client only
+     */
+    uint32_t head;
+    /*
+     * Advanced by the server only
+     */
+    uint32_t tail;
+    /*
+     * Set by the client while it waits for the tail to advance
+     */
+    uint32_t waiting;
+    /*
+     * Number of bytes of the client's last read, stored in the
+     * client's buffer by the server before it signals read_aep
+     * (SEL4OSAPI_SERIAL_READ_PENDING until then).
+     */
+    uint32_t read_len;
+    /*
+     * Position of the ring up to which the client's records were
+     * transmitted, stored by the server when it completes a flush
+     * before it signals flush_aep.
+     */
+    uint32_t flushed;
+    char data[SEL4OSAPI_SERIAL_RING_SIZE];
+} sel4osapi_serial_ring_t;
+
+typedef struct sel4osapi_serial_record
+{
+    uint16_t dev;
+    uint16_t len;
+} sel4osapi_serial_record_t;
+
+/*
+ * Pages shared by a client and a port's server thread: the
+ * client's memory buffer, followed by its ring.
+ */
+#define SEL4OSAPI_SERIAL_SHM_PAGES      (SEL4OSAPI_SERIAL_BUF_PAGES + \
+        ROUND_UP_UNSAFE(sizeof(sel4osapi_serial_ring_t), PAGE_SIZE_4K) / PAGE_SIZE_4K)
+
+/*
+ * A client's context for a single serial port (unused if
+ * server_ep is seL4_CapNull, when the port is not enabled).
+ */
+typedef struct sel4osapi_serialclient_port
 {
-    int id;
     sel4osapi_semaphore_t *buf_avail;
     void *buf;
     uint32_t buf_size;
+    /*
+     * Copy of the port's EP, badged with the client's slot.
+     */
     seL4_CPtr server_ep;
+    sel4osapi_serial_ring_t *ring;
+    /*
+     * Serializes the client's threads writing to the ring
+     * (user process only).
+     */
+    sel4osapi_mutex_t *ring_lock;
+    /*
+     * Serializes the client's threads flushing the ring
+     * (user process only).
+     */
+    sel4osapi_mutex_t *flush_lock;
+    /*
+     * Badged cap to the port's AEP, signaled by the client
+     * when its ring becomes non-empty.
+     */
+    seL4_CPtr server_aep;
+    /*
+     * AEP signaled by the server when the ring's tail
+     * advances while the client is waiting.
+     */
+    seL4_CPtr client_aep;
+    /*
+     * AEP signaled by the server when the client's read completes.
+     */
+    seL4_CPtr read_aep;
+    /*
+     * AEP signaled by the server when the client's flush completes.
+     */
+    seL4_CPtr flush_aep;
+    /*
+     * The client's pending read (server only): bytes requested
+     * (0 if none) and copied so far, and its sysclock timeout
+     * (0 to wait forever) and deadline.
+     */
+    uint32_t read_size;
+    uint32_t read_count;
+    seL4_Word read_timeout_id;
+    uint32_t read_deadline;
+    /*
+     * The client's pending flush (server only): the ticket it
+     * waits for, and the matching position of the port's
+     * transmit ring.
+     */
+    int flush_pending;
+    uint32_t flush_ticket;
+    uint32_t flush_until;
+    /*
+     * Set once the client corrupted its ring, which
+     * is then no longer drained (server only).
+     */
+    int corrupt;
+} sel4osapi_serialclient_port_t;
+
+typedef struct sel4osapi_serialclient
+{
+    int id;
+    sel4osapi_serialclient_port_t ports[SEL4OSAPI_SERIAL_PORTS];
 } sel4osapi_serialclient_t;
 
-typedef struct sel4osapi_serialserver
+struct sel4osapi_serialserver;
+
+/*
+ * A serial port, served by a thread of its own.
+ *
+ * The UART's IRQ is bound to an AEP, on which a dedicated thread
+ * waits to drain the received bytes into the port's receive ring,
+ * and to hand the bytes queued by the server thread in the transmit
+ * ring to the driver. Each ring has a single producer and a single
+ * consumer (the IRQ thread and the server thread), so it needs no lock.
+ */
+typedef struct sel4osapi_serialport
 {
+    struct sel4osapi_serialserver *server;
+    sel4osapi_serialdevice_t id;
+    ps_chardevice_t dev;
+    /*
+     * EP on which the server thread receives requests,
+     * and AEP bound to the server thread, signaled by
+     * clients with a badge identifying their slot.
+     */
     seL4_CPtr server_ep;
-    sel4osapi_mutex_t *mutex;
-    simple_pool_t *clients;
+    vka_object_t server_aep;
     sel4osapi_thread_t *thread;
-    ps_chardevice_t uart1, uart2;
+    /*
+     * Copies of server_aep, signaled when bytes are received
+     * for a pending read or a read's timeout expires, and when
+     * bytes are transmitted for a pending flush.
+     */
+    seL4_CPtr reads_aep;
+    seL4_CPtr flushes_aep;
+    /*
+     * Number of clients with a pending read, and with a
+     * pending flush, on the port.
+     */
+    int reads_pending;
+    int flushes_pending;
+    seL4_CPtr irq;
+    seL4_CPtr irq_aep;
+    sel4osapi_thread_t *irq_thread;
+    char rx_ring[SEL4OSAPI_SERIAL_RX_RING_SIZE];
+    uint32_t rx_head;
+    uint32_t rx_tail;
+    /*
+     * Bytes dropped because the ring was full.
+     */
+    uint32_t rx_dropped;
+    /*
+     * AEP of the thread waiting for received bytes
+     * (seL4_CapNull if none).
+     */
+    seL4_CPtr rx_waiter;
+    char tx_ring[SEL4OSAPI_SERIAL_TX_RING_SIZE];
+    uint32_t tx_head;
+    uint32_t tx_tail;
+    /*
+     * AEP of the thread waiting for queued bytes to be
+     * transmitted (flushes_aep while flushes are pending,
+     * seL4_CapNull if none).
+     */
+    seL4_CPtr tx_waiter;
+    /*
+     * Clients whose ring was found corrupt, and is no longer drained.
+     */
+    uint32_t corrupt_rings;
+    /*
+     * Badged copy of irq_aep, signaled by the server thread
+     * when it queues new bytes.
+     */
+    seL4_CPtr tx_aep;
+} sel4osapi_serialport_t;
+
+typedef struct sel4osapi_serialserver
+{
+    simple_pool_t *clients;
+    /*
+     * Maps client ids to clients. The index of a client's
+     * slot is the badge of its caps to the ports.
+     */
+    simple_handle_table_t *client_ids;
+    sel4osapi_serialclient_t *slots[SEL4OSAPI_USER_PROCESS_MAX];
+    /*
+     * Ports, indexed by SEL4OSAPI_SERIAL_PORT_INDEX (NULL
+     * thread if the port is not enabled).
+     */
+    sel4osapi_serialport_t ports[SEL4OSAPI_SERIAL_PORTS];
 } sel4osapi_serialserver_t;
 
 
@@ -72,6 +297,24 @@ sel4osapi_io_serial_create_client(sel4osapi_serialserver_t *server);
 int
 sel4osapi_io_serial_write(sel4osapi_serialdevice_t dev, void *data, uint32_t size);
 
+/*
+ * Queue data for transmission in the process' ring, returning as
+ * soon as it is queued (possibly before it is transmitted). The
+ * position of the data in the ring is returned in ticket_out, to
+ * be passed to sel4osapi_io_serial_flush.
+ * Returns the number of bytes queued.
+ */
+int
+sel4osapi_io_serial_write_async(sel4osapi_serialdevice_t dev, void *data, uint32_t size, uint32_t *ticket_out);
+
+/*
+ * Wait until the data queued with the write which returned 'ticket'
+ * (or all data queued by the process, with SEL4OSAPI_SERIAL_FLUSH_ALL)
+ * is transmitted.
+ */
+int
+sel4osapi_io_serial_flush(sel4osapi_serialdevice_t dev, uint32_t ticket);
+
 int
 sel4osapi_io_serial_read(sel4osapi_serialdevice_t dev, void *data, uint32_t size, size_t timeout);
 
@@ -28,6 +28,10 @@ typedef struct sel4osapi_ipcserver
 {
     sel4osapi_mutex_t *mutex;
     simple_pool_t *clients;
+    /*
+     * Maps client ids to clients.
+     */
+    simple_handle_table_t *client_ids;
 } sel4osapi_ipcserver_t;
 
 
@@ -35,7 +39,13 @@ int
 sel4osapi_ipcserver_initialize(sel4osapi_ipcserver_t *ipc);
 
 sel4osapi_ipcclient_t*
-sel4osapi_ipc_create_client(sel4osapi_ipcserver_t *ipc, int id);
+sel4osapi_ipc_create_client(sel4osapi_ipcserver_t *ipc);
+
+/*
+ * Resolve a client id. Returns NULL if the id is not (or no longer) valid.
+ */
+sel4osapi_ipcclient_t*
+sel4osapi_ipc_get_client(sel4osapi_ipcserver_t *ipc, int id);
 
 
 
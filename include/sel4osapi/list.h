@@ -39,6 +39,17 @@ typedef struct sel4osapi_list_node
     struct sel4osapi_list_node *prev;
 } sel4osapi_list_t;
 
+/*
+ * Data structure representing a list
+ * through its first and last node.
+ */
+typedef struct sel4osapi_list_head
+{
+    sel4osapi_list_t *head;
+    sel4osapi_list_t *tail;
+    int count;
+} sel4osapi_list_head_t;
+
 
 /** \brief Insert a new node into a list.
  *
@@ -98,4 +109,67 @@ sel4osapi_list_to_array(sel4osapi_list_t *head, void **array, int array_len_max,
 void
 sel4osapi_list_print(sel4osapi_list_t *list, char *prefix);
 
+/** \brief Initialize an empty list head.
+ *
+ * \param list      the list to initialize
+ */
+void
+sel4osapi_list_head_init(sel4osapi_list_head_t *list);
+
+/** \brief Insert a node at the end of a list, in constant time.
+ *
+ * \param list      the list
+ * \param node      the node to insert in the list
+ */
+void
+sel4osapi_list_head_append(sel4osapi_list_head_t *list, sel4osapi_list_t *node);
+
+/** \brief Insert a node at the beginning of a list, in constant time.
+ *
+ * \param list      the list
+ * \param node      the node to insert in the list
+ */
+void
+sel4osapi_list_head_prepend(sel4osapi_list_head_t *list, sel4osapi_list_t *node);
+
+/** \brief Remove a node from a list by unlinking it, in constant time.
+ *
+ * The actual node is not deleted.
+ *
+ * \param list      the list
+ * \param node      the node to remove (must belong to the list)
+ */
+void
+sel4osapi_list_head_unlink(sel4osapi_list_head_t *list, sel4osapi_list_t *node);
+
+/** \brief Remove the first node of a list.
+ *
+ * \param list      the list
+ * \return          the removed node, or NULL if the list is empty
+ */
+sel4osapi_list_t*
+sel4osapi_list_head_pop(sel4osapi_list_head_t *list);
+
+/** \brief Push a node on a stack shared by multiple threads, without locking.
+ *
+ * Any number of threads can push nodes concurrently, while a single
+ * thread takes them with sel4osapi_list_atomic_take(). Only the next
+ * pointer of the node is used.
+ *
+ * \param top       the top of the stack
+ * \param node      the node to push
+ */
+void
+sel4osapi_list_atomic_push(sel4osapi_list_t **top, sel4osapi_list_t *node);
+
+/** \brief Atomically take all the nodes of a stack filled by
+ * sel4osapi_list_atomic_push().
+ *
+ * \param top       the top of the stack
+ * \return          the nodes, linked through their next pointers
+ *                  from the last pushed to the first, or NULL
+ */
+sel4osapi_list_t*
+sel4osapi_list_atomic_take(sel4osapi_list_t **top);
+
 #endif /* SEL4OSAPI_LINKED_LIST_H_ */
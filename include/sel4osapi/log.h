@@ -30,10 +30,16 @@
  *      syslog_warn
  *      syslog_error
  *
+ * Write out all queued messages (e.g. before exiting):
+ *      sel4osapi_log_flush();
+ *
  * NOTE:
  *      Syslog will work even before calling sel4osapi_log_initialize(), but will not
  *      be thread-safe. After calling sel4osapi_log_initialize() the log subsystem will
- *      be thread-safe (as it will use a global mutex to serialize log messages).
+ *      be thread-safe. With CONFIG_LIB_OSAPI_LOG_ASYNC, messages are formatted by the
+ *      calling thread into a lock-free ring, and written to the console in batches by
+ *      a low priority thread (messages are dropped, and counted, if the ring is full).
+ *      Errors are still written synchronously, after the queued messages. Otherwise, a global mutex serializes log messages, written synchronously.
  *
  */
 
@@ -161,11 +167,18 @@ sel4osapi_log_lock();
 void
 sel4osapi_log_unlock();
 
+/*
+ * Write all queued log messages to the console, from the calling thread.
+ */
+void
+sel4osapi_log_flush();
+
 
 static inline void sel4osapi_log_set_console(int logConsole) {
     syslog_info("================================");
     syslog_info("Switching logging console...");
     syslog_info("================================");
+    sel4osapi_log_flush();
     sel4osapi_logconsole = logConsole;
     syslog_info("Logging continue on secondary console...");
 }
@@ -12,19 +12,80 @@
 #ifndef SEL4OSAPI_MEMORY_H_
 #define SEL4OSAPI_MEMORY_H_
 
+/*
+ * Size classes of the heap: powers of two from
+ * 1 << SEL4OSAPI_HEAP_MIN_CLASS_BITS up to
+ * 1 << (SEL4OSAPI_HEAP_MIN_CLASS_BITS + SEL4OSAPI_HEAP_CLASSES - 1).
+ * Larger requests are served with dedicated pages.
+ */
+#define SEL4OSAPI_HEAP_MIN_CLASS_BITS       4
+#define SEL4OSAPI_HEAP_CLASSES              7
+#define SEL4OSAPI_HEAP_CLASS_LARGE          SEL4OSAPI_HEAP_CLASSES
+
+/*
+ * Usage counters of a size class.
+ */
+typedef struct sel4osapi_heap_class_stats
+{
+    /*
+     * Block size (0 for large allocations)
+     */
+    size_t block_size;
+    /*
+     * Pages currently owned by the class
+     */
+    unsigned int pages;
+    /*
+     * Blocks carved out of the class' pages
+     * (large allocations: live allocations)
+     */
+    unsigned int blocks;
+    unsigned int blocks_in_use;
+    unsigned int peak_blocks_in_use;
+    unsigned long allocs;
+    unsigned long frees;
+    /*
+     * Total bytes requested by, and handed out to,
+     * all allocations so far: their ratio measures
+     * internal fragmentation.
+     */
+    unsigned long long requested_bytes;
+    unsigned long long allocated_bytes;
+} sel4osapi_heap_class_stats_t;
+
+/*
+ * Initialize the process' heap, drawing pages from the specified vspace.
+ * Must be called before any other sel4osapi_heap_* operation.
+ */
+void
+sel4osapi_heap_initialize(vspace_t *vspace, vka_t *vka);
+
 /*
  * Allocate a buffer of the specified size.
- * Wrapper to malloc().
+ * Buffers of up to 1K are carved out of pages dedicated
+ * to their size class, larger ones get pages of their own.
  */
 void*
 sel4osapi_heap_allocate(size_t size);
 
 /*
  * Free the specified memory.
- * Wrapper to free().
  */
 void
 sel4osapi_heap_free(void* ptr);
 
+/*
+ * Copy the usage counters of a size class
+ * (or SEL4OSAPI_HEAP_CLASS_LARGE).
+ */
+void
+sel4osapi_heap_get_stats(int size_class, sel4osapi_heap_class_stats_t *stats_out);
+
+/*
+ * Log the usage counters of all size classes.
+ */
+void
+sel4osapi_heap_print_stats(void);
+
 
 #endif /* SEL4OSAPI_MEMORY_H_ */
@@ -14,30 +14,44 @@
 
 
 #include <sel4osapi/thread.h>
-#include "sync/recursive_mutex.h"
+#include <sel4osapi/semaphore.h>
 
-extern vka_t* sel4osapi_system_get_vka();
-
-typedef sync_recursive_mutex_t sel4osapi_mutex_t;
-
-static inline sel4osapi_mutex_t *sel4osapi_mutex_create() {
-    
-    sync_recursive_mutex_t *mutex = (sync_recursive_mutex_t *) sel4osapi_heap_allocate(sizeof(sync_recursive_mutex_t));
-    assert(mutex);
-    assert(sync_recursive_mutex_new(sel4osapi_system_get_vka(), mutex) == 0);
-    return (sel4osapi_mutex_t *)mutex;
-}
+/*
+ * Recursive mutex, built on a binary semaphore so that
+ * it supports timed locking.
+ */
+typedef struct sel4osapi_mutex
+{
+    sel4osapi_semaphore_t sem;
+    /*
+     * IPC buffer of the owning thread (NULL if unlocked),
+     * and number of times the owner locked the mutex.
+     */
+    void *owner;
+    int held;
+} sel4osapi_mutex_t;
+
+sel4osapi_mutex_t*
+sel4osapi_mutex_create();
+
+void
+sel4osapi_mutex_delete(sel4osapi_mutex_t *mutex);
 
-static inline void sel4osapi_mutex_delete(sel4osapi_mutex_t *mutex) {
-    sync_recursive_mutex_destroy(sel4osapi_system_get_vka(), (sync_recursive_mutex_t *)mutex);
-}
+/*
+ * Lock the mutex, waiting for at most timeout_ms milliseconds
+ * (SEL4OSAPI_WAIT_FOREVER: no limit, 0: do not wait).
+ * Returns 0 on success, SEL4OSAPI_WAIT_TIMEOUT if the timeout expired.
+ */
+int
+sel4osapi_mutex_lock_timed(sel4osapi_mutex_t *mutex, int32_t timeout_ms);
 
-static inline int sel4osapi_mutex_lock(sel4osapi_mutex_t *mutex) {
-    return sync_recursive_mutex_lock((sync_recursive_mutex_t *)mutex);
+static inline int
+sel4osapi_mutex_lock(sel4osapi_mutex_t *mutex)
+{
+    return sel4osapi_mutex_lock_timed(mutex, SEL4OSAPI_WAIT_FOREVER);
 }
 
-static inline int sel4osapi_mutex_unlock(sel4osapi_mutex_t *mutex) {
-    return sync_recursive_mutex_unlock((sync_recursive_mutex_t *)mutex);
-}
+int
+sel4osapi_mutex_unlock(sel4osapi_mutex_t *mutex);
 
 #endif /* SEL4OSAPI_MUTEX_H_ */
@@ -31,12 +31,13 @@
 
 #include "sel4osapi/list.h"
 #include "sel4osapi/pool.h"
+#include "sel4osapi/handle.h"
 
 #include "sel4osapi/config.h"
 #include "sel4osapi/memory.h"
 #include "sel4osapi/thread.h"
-#include "sel4osapi/mutex.h"
 #include "sel4osapi/semaphore.h"
+#include "sel4osapi/mutex.h"
 
 #include "sel4osapi/ipc.h"
 
@@ -51,6 +52,7 @@
 
 #ifdef CONFIG_LIB_OSAPI_SYSCLOCK
 #include "sel4osapi/clock.h"
+#include "sel4osapi/timer.h"
 #endif
 
 #include "sel4osapi/log.h"
@@ -16,22 +16,208 @@
 typedef void (*simple_pool_init_el_fn)(void *el, void *arg);
 typedef int (*simple_pool_compare_el_fn)(void *el1, void *el2);
 
+/*
+ * Allocator used by a growable pool to obtain the memory
+ * for a new chunk of elements. Returns NULL on failure.
+ */
+typedef void *(*simple_pool_chunk_alloc_fn)(size_t bytes, void *arg);
+
+/*
+ * Hidden header stored in front of every element handed out by a pool.
+ * It links the element back to its list node so that simple_pool_free()
+ * does not have to search the pool's entries.
+ */
+typedef struct simple_pool_el_header
+{
+    struct simple_pool *pool;
+    sel4osapi_list_t *node;
+    int allocated;
+    /*
+     * Lock-free pools only: index (+1) of the next
+     * free slot, or 0 at the bottom of the free stack.
+     */
+    uint32_t next_free;
+    /*
+     * Slab pools only: index of the element's slot.
+     */
+    uint32_t index;
+} simple_pool_el_header_t;
+
+/*
+ * Size of the element header, rounded up so that the element
+ * that follows it keeps the alignment returned by malloc().
+ */
+#define SIMPLE_POOL_EL_HEADER_SIZE \
+    ROUND_UP_UNSAFE(sizeof(simple_pool_el_header_t), 2 * sizeof(seL4_Word))
+
+#define simple_pool_el_header(el_) \
+    ((simple_pool_el_header_t *) (((char *) (el_)) - SIMPLE_POOL_EL_HEADER_SIZE))
+
+/*
+ * Slots of a slab pool are padded to this size, so that two
+ * elements never share a cache line.
+ */
+#define SIMPLE_POOL_CACHE_LINE_SIZE     64
+
+/*
+ * Pool flags
+ */
+#define SIMPLE_POOL_FLAG_SLAB           (1 << 0)
+#define SIMPLE_POOL_FLAG_LOCKFREE       (1 << 1)
+#define SIMPLE_POOL_FLAG_MAGAZINES      (1 << 2)
+
+/*
+ * Per-thread magazines: maximum number of free elements
+ * cached by a thread for a pool, and maximum number of
+ * pools a thread can cache elements for.
+ */
+#define SIMPLE_POOL_MAGAZINE_SIZE           16
+#define SIMPLE_POOL_MAGAZINES_PER_THREAD    4
+
+/*
+ * The free list of a lock-free pool is a stack of slot indices. Its head
+ * packs the index (+1) of the top slot in the lower 32 bits and a
+ * modification counter in the upper 32 bits, which is bumped on every
+ * update so that a compare-and-swap cannot succeed on a recycled (ABA)
+ * head.
+ */
+#define SIMPLE_POOL_FREE_HEAD_INDEX(head_)      ((uint32_t) ((head_) & 0xffffffffULL))
+#define SIMPLE_POOL_FREE_HEAD_TAG(head_)        ((uint32_t) ((head_) >> 32))
+#define SIMPLE_POOL_FREE_HEAD(tag_, index_)     ((((uint64_t) (tag_)) << 32) | (uint64_t) (index_))
+
 typedef struct simple_pool
 {
-    sel4osapi_list_t *free_entries;
-    sel4osapi_list_t *entries;
+    sel4osapi_list_head_t free_entries;
+    sel4osapi_list_head_t entries;
     size_t el_size;
     int size;
     int current_size;
     simple_pool_init_el_fn init_fn;
     void *init_arg;
     simple_pool_compare_el_fn compare_fn;
+    unsigned int flags;
+    /*
+     * Backing store of a slab pool: contiguous slots
+     * of 'slab_stride' bytes, each one holding the element's
+     * list node, header and the element itself.
+     * 'slab' is the first chunk of slots, allocated with the pool.
+     */
+    char *slab;
+    size_t slab_stride;
+    size_t slab_el_offset;
+    /*
+     * Chunks of 'chunk_size' slots backing a slab pool. Slot i lives in
+     * chunks[i / chunk_size]. A pool which cannot grow has a single
+     * chunk (its slab) and max_size == size.
+     */
+    char **chunks;
+    int chunks_num;
+    int chunk_size;
+    int max_size;
+    simple_pool_chunk_alloc_fn chunk_alloc;
+    void *chunk_alloc_arg;
+    int growing;
+    /*
+     * Free list head of a lock-free pool
+     * (see SIMPLE_POOL_FREE_HEAD).
+     */
+    uint64_t free_head;
 } simple_pool_t;
 
+/*
+ * Stash of free elements of one pool, owned by a single thread.
+ */
+typedef struct simple_pool_magazine
+{
+    simple_pool_t *pool;
+    int count;
+    sel4osapi_list_t *rounds[SIMPLE_POOL_MAGAZINE_SIZE];
+} simple_pool_magazine_t;
+
+/*
+ * Per-thread set of magazines, referenced by
+ * the thread's sel4osapi_thread_info_t.
+ */
+typedef struct simple_pool_thread_cache
+{
+    simple_pool_magazine_t magazines[SIMPLE_POOL_MAGAZINES_PER_THREAD];
+} simple_pool_thread_cache_t;
+
 
 simple_pool_t*
 simple_pool_new(int size, size_t el_size, simple_pool_init_el_fn init_fn, void *init_arg, simple_pool_compare_el_fn compare_fn);
 
+/*
+ * Create a pool whose elements, headers and list nodes are all
+ * carved out of a single cache-line aligned allocation, which also
+ * holds the pool itself. Slots are laid out back to back, so
+ * consecutive allocations touch adjacent memory.
+ */
+simple_pool_t*
+simple_pool_new_slab(int size, size_t el_size, simple_pool_init_el_fn init_fn, void *init_arg, simple_pool_compare_el_fn compare_fn);
+
+/*
+ * Create a slab pool which can be shared by multiple threads without
+ * any external locking. simple_pool_alloc() and simple_pool_free() pop
+ * and push slots on an atomic, ABA-safe free list.
+ *
+ * A lock-free pool does not keep track of allocated elements: its
+ * 'entries' list is always empty and simple_pool_find_node() always
+ * returns NULL.
+ */
+simple_pool_t*
+simple_pool_new_lockfree(int size, size_t el_size, simple_pool_init_el_fn init_fn, void *init_arg);
+
+/*
+ * Allow a slab (or lock-free) pool to grow on demand, up to max_size
+ * elements. When the pool runs out of free elements it adds a new chunk
+ * of as many elements as it was created with, obtained from chunk_alloc
+ * (or malloc() if NULL). Existing elements never move.
+ *
+ * Must be called right after creating the pool, before it is shared.
+ * A lock-free pool grows from whichever thread finds it empty; a
+ * concurrent allocation that finds another thread already growing the
+ * pool fails instead of waiting.
+ */
+void
+simple_pool_set_growth(simple_pool_t *pool, int max_size, simple_pool_chunk_alloc_fn chunk_alloc, void *chunk_alloc_arg);
+
+/*
+ * Chunk allocator for simple_pool_set_growth() which maps fresh pages
+ * in a vspace (arg), or in the process' vspace if arg is NULL.
+ */
+void*
+simple_pool_vspace_chunk_alloc(size_t bytes, void *arg);
+
+/*
+ * Put per-thread magazines in front of a lock-free pool.
+ *
+ * Each thread then keeps up to SIMPLE_POOL_MAGAZINE_SIZE free elements
+ * of the pool in a private stash, which is refilled from (or drained
+ * into) the shared free list half a magazine at a time. Allocations and
+ * frees served by the stash do not touch any shared state.
+ *
+ * Elements sitting in a thread's magazine are counted as allocated by
+ * simple_pool_get_current_size(). A thread can cache elements for at
+ * most SIMPLE_POOL_MAGAZINES_PER_THREAD pools, other pools fall back to
+ * the shared free list.
+ *
+ * Elements cached by a thread cannot be allocated by other threads:
+ * an allocation fails once the shared free list is empty, even if
+ * other threads' magazines still hold free elements. Only enable
+ * magazines on pools with plenty of spare elements.
+ */
+void
+simple_pool_enable_magazines(simple_pool_t *pool);
+
+/*
+ * Return all elements cached by the calling thread to their pools,
+ * and release the thread's magazines.
+ * Called automatically when an sel4osapi thread terminates.
+ */
+void
+simple_pool_flush_thread_cache(void);
+
 void*
 simple_pool_alloc(simple_pool_t *pool);
 
@@ -50,4 +236,18 @@ simple_pool_find_node(simple_pool_t *pool, void *el);
 int
 simple_pool_get_current_size(simple_pool_t *pool);
 
+#ifdef CONFIG_LIB_OSAPI_POOL_BENCHMARK
+/*
+ * Measure the average cost of freeing an element and allocating
+ * it back, over 'iterations' rounds, on pools of increasing size
+ * which are kept half full. The results are printed on the console,
+ * in CPU cycles if available (see sel4osapi_sysclock_get_cycles()),
+ * in nanoseconds otherwise. The cost should not depend on the size.
+ *
+ * The pools are not released afterwards.
+ */
+void
+simple_pool_benchmark(int iterations);
+#endif
+
 #endif /* SEL4OSAPI_POOL_C_ */
@@ -78,6 +78,15 @@ typedef struct sel4osapi_process_env {
      * Endpoint to the sysclock instance.
      */
     seL4_CPtr sysclock_server_ep;
+    /*
+     * Endpoint to the sysclock's time queries.
+     */
+    seL4_CPtr sysclock_time_ep;
+    /*
+     * Read-only mapping of the sysclock's time page
+     * (NULL if the sysclock does not publish one).
+     */
+    struct sel4osapi_sysclock_time_page *sysclock_time_page;
     /*
      * Async Endpoint used to block the process'
      * threads in idling mode.
@@ -88,6 +97,10 @@ typedef struct sel4osapi_process_env {
      * Threads created by this process
      */
     simple_pool_t *threads;
+    /*
+     * Maps thread ids to the threads created by this process
+     */
+    simple_handle_table_t *thread_ids;
 
     /*
      * Priority of the process.
@@ -12,31 +12,61 @@
 #ifndef SEL4OSAPI_SEMAPHORE_H_
 #define SEL4OSAPI_SEMAPHORE_H_
 
-#include "sync/sem.h"
+#include "sync/mutex.h"
 
-extern vka_t* sel4osapi_system_get_vka();
-
-typedef sync_sem_t sel4osapi_semaphore_t;
-
-static inline sel4osapi_semaphore_t* sel4osapi_semaphore_create(int init) {
-    sync_sem_t * sem = (sync_sem_t *) sel4osapi_heap_allocate(sizeof(sync_sem_t));
-    assert(sync_sem_new(sel4osapi_system_get_vka(), sem, init) == 0);
-    return sem;
-}
-
-static inline void sel4osapi_semaphore_delete(sel4osapi_semaphore_t* sem) {
-    sync_sem_destroy(sel4osapi_system_get_vka(), (sync_sem_t *)sem);
-}
+/*
+ * Timeout value to wait without a time limit.
+ */
+#define SEL4OSAPI_WAIT_FOREVER      (-1)
+/*
+ * Value returned by timed waits when the timeout expires.
+ */
+#define SEL4OSAPI_WAIT_TIMEOUT      1
 
-static inline int sel4osapi_semaphore_take(sel4osapi_semaphore_t* sem, UNUSED int32_t timeout) {
-    return sync_sem_wait(sem);
-}
+/*
+ * Counting semaphore.
+ *
+ * The count is updated atomically, so that uncontended takes
+ * and gives do not enter the kernel. A negative count is the
+ * number of threads which are waiting, or about to.
+ *
+ * Threads which have to wait are queued in FIFO order, and
+ * block on their own semaphore AEP (sem_aep, see
+ * sel4osapi_thread_info_t), which nothing else signals.
+ * A timed wait schedules a one-shot sysclock timeout on the
+ * same AEP, so that the thread wakes up on whichever of the
+ * two happens first.
+ */
+typedef struct sel4osapi_semaphore
+{
+    int count;
+    /*
+     * Protects the queue of waiters and the grants
+     */
+    sync_mutex_t lock;
+    sel4osapi_list_head_t waiters;
+    /*
+     * Units given to threads which had decremented the
+     * count, but had not queued up yet
+     */
+    int grants;
+} sel4osapi_semaphore_t;
 
-static inline int sel4osapi_semaphore_give(sel4osapi_semaphore_t* sem) {
-    return sync_sem_post(sem);
-}
+sel4osapi_semaphore_t*
+sel4osapi_semaphore_create(int init);
 
+void
+sel4osapi_semaphore_delete(sel4osapi_semaphore_t* sem);
 
+/*
+ * Decrement the semaphore, waiting for at most timeout_ms
+ * milliseconds (SEL4OSAPI_WAIT_FOREVER: no limit, 0: do not wait).
+ * Returns 0 on success, SEL4OSAPI_WAIT_TIMEOUT if the timeout expired.
+ */
+int
+sel4osapi_semaphore_take(sel4osapi_semaphore_t* sem, int32_t timeout_ms);
 
+int
+sel4osapi_semaphore_give(sel4osapi_semaphore_t* sem);
 
 #endif /* SEL4OSAPI_SEMAPHORE_H_ */
@@ -18,6 +18,25 @@
 #error "SEL4OSAPI_THREAD_NAME_MAX_LEN must be greater than SEL4OSAPI_THREAD_NAME_PREFIX_MAX_LEN"
 #endif
 
+/*
+ * Number of AEPs (including the thread's own wait_aep and sem_aep)
+ * whose sysclock notifiers a thread keeps registered. Timeouts on
+ * further AEPs register a notifier each, released with the timeout.
+ */
+#define SEL4OSAPI_THREAD_SYSCLOCK_NOTIFIERS     4
+
+/*
+ * Notifier registered with the sysclock for one of a thread's AEPs.
+ */
+typedef struct sel4osapi_thread_notifier
+{
+    seL4_CPtr aep;
+    /*
+     * Notifier id (0 if the entry is unused)
+     */
+    seL4_Word id;
+} sel4osapi_thread_notifier_t;
+
 /*
  * Data structure containing all contextual
  * information pertaining a thread.
@@ -40,6 +59,11 @@ typedef struct sel4osapi_thread_info
      * User data
      */
     void *tls;
+    /*
+     * Per-thread pool magazines (simple_pool_thread_cache_t),
+     * allocated on first use by a pool with magazines enabled.
+     */
+    void *pool_cache;
     /*
      * Whether the thread is active or not.
      * A thread should terminate once this
@@ -52,6 +76,17 @@ typedef struct sel4osapi_thread_info
      * wait.
      */
     seL4_CPtr wait_aep;
+    /*
+     * Async endpoint on which the thread waits for
+     * semaphores (and mutexes), so that their signals
+     * never mix with those expected on wait_aep.
+     */
+    seL4_CPtr sem_aep;
+    /*
+     * Notifiers registered with the sysclock for the
+     * AEPs the thread scheduled timeouts on.
+     */
+    sel4osapi_thread_notifier_t sysclock_notifiers[SEL4OSAPI_THREAD_SYSCLOCK_NOTIFIERS];
     /*
      * Priority of the thread.
      */
@@ -89,6 +124,10 @@ typedef struct sel4osapi_thread
      * thread waits.
      */
     vka_object_t thread_aep;
+    /*
+     * Async endpoint used to wait for semaphores.
+     */
+    vka_object_t sem_aep;
     /*
      * "Native" thread.
      */
@@ -133,6 +172,13 @@ sel4osapi_thread_join(sel4osapi_thread_t *thread);
 void
 sel4osapi_thread_delete(sel4osapi_thread_t *thread);
 
+/*
+ * Find a thread of the current process by id.
+ * Returns NULL if the id is not (or no longer) valid.
+ */
+sel4osapi_thread_t*
+sel4osapi_thread_get(int tid);
+
 /*
  * Access contextual information about the current thread.
  */
@@ -142,6 +188,50 @@ sel4osapi_thread_get_current();
 seL4_Uint32
 sel4osapi_thread_sleep(uint32_t ms);
 
+/*
+ * Suspend the calling thread until the sysclock's time reaches
+ * deadline_ms. Returns immediately, with the current time, if the
+ * deadline has already passed.
+ */
+seL4_Uint32
+sel4osapi_thread_sleep_until(uint32_t deadline_ms);
+
+/*
+ * Periodic activation of a thread, driven by a periodic
+ * sysclock timeout.
+ */
+typedef struct sel4osapi_thread_periodic
+{
+    seL4_Word timeout_id;
+    uint32_t period_ms;
+    /*
+     * Time of the activation the thread is waiting for.
+     */
+    uint32_t next_activation;
+} sel4osapi_thread_periodic_t;
+
+/*
+ * Start activating the calling thread every period_ms milliseconds,
+ * the first time at the absolute time start_ms.
+ * Returns 0 on success.
+ */
+int
+sel4osapi_thread_periodic_start(sel4osapi_thread_periodic_t *periodic, uint32_t start_ms, uint32_t period_ms);
+
+/*
+ * Wait for the next activation of the calling thread. Returns
+ * the number of activations that were missed since the previous
+ * call, because the thread was late to wait for them.
+ */
+uint32_t
+sel4osapi_thread_periodic_wait(sel4osapi_thread_periodic_t *periodic);
+
+/*
+ * Stop the periodic activation of the calling thread.
+ */
+void
+sel4osapi_thread_periodic_stop(sel4osapi_thread_periodic_t *periodic);
+
 /* ---------------------------------------------------------------------------
  * FABRIZIO: Those functions are not needed and should be replaced with seL4_GetMR/seL4_SetMR
  */
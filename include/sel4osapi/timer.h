@@ -0,0 +1,77 @@
+/*
+ * FILE: timer.h - callback timers for sel4osapi
+ *
+ * Copyright (c) 2015, Real-Time Innovations, Inc. All rights reserved.
+ *
+ * This software may be distributed and modified according to the terms of
+ * the BSD 2-Clause license. Note that NO WARRANTY is provided.
+ * See "LICENSE_BSD2.txt" for details.
+ *
+ */
+
+#ifndef SEL4OSAPI_TIMER_H_
+#define SEL4OSAPI_TIMER_H_
+
+/*
+ * Function run by the timer service when a timer expires.
+ */
+typedef void (*sel4osapi_timer_callback_fn)(void *arg);
+
+/*
+ * A timer whose callback is run by the process' timer service.
+ *
+ * Timers are owned by the caller, and must not be released
+ * while they are scheduled.
+ */
+typedef struct sel4osapi_timer
+{
+    sel4osapi_timer_callback_fn callback;
+    void *arg;
+    /*
+     * Next expiration (sysclock time).
+     */
+    uint32_t deadline;
+    /*
+     * Period of the timer (0 for one-shot timers).
+     */
+    uint32_t period_ms;
+    /*
+     * Position in the service's heap (-1 if not scheduled).
+     */
+    int index;
+} sel4osapi_timer_t;
+
+/*
+ * Start the timer service of the current process: a single
+ * thread which runs the callbacks of all the process' timers,
+ * earliest deadline first.
+ * Returns 0 on success.
+ */
+int
+sel4osapi_timer_service_start(int priority);
+
+/*
+ * Initialize a timer. The timer is not scheduled.
+ */
+void
+sel4osapi_timer_init(sel4osapi_timer_t *timer, sel4osapi_timer_callback_fn callback, void *arg);
+
+/*
+ * Schedule a timer to expire after delay_ms milliseconds, and then
+ * every period_ms milliseconds (if period_ms > 0). A scheduled
+ * timer is rescheduled. Periodic timers do not drift: activations
+ * which are missed altogether are skipped.
+ * Returns 0 on success, -1 if the service cannot take more timers.
+ */
+int
+sel4osapi_timer_start(sel4osapi_timer_t *timer, uint32_t delay_ms, uint32_t period_ms);
+
+/*
+ * Unschedule a timer. The timer's callback may still be running
+ * when the function returns, if it was already started.
+ * Returns 0 if the timer was scheduled, -1 otherwise.
+ */
+int
+sel4osapi_timer_stop(sel4osapi_timer_t *timer);
+
+#endif /* SEL4OSAPI_TIMER_H_ */
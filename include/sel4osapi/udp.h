@@ -17,6 +17,7 @@
 #define SEL4OSAPI_UDP_PORT_BASE             8000
 
 #define SEL4OSAPI_UDP_MAX_MSGS_PER_CLIENT   1000
+#define SEL4OSAPI_UDP_MSGS_CHUNK_SIZE       64
 
 #define SEL4OSAPI_UDP_MAX_SOCKETS           MEMP_NUM_UDP_PCB
 #define SEL4OSAPI_UDP_SOCKET_FIRST_PORT     50000
@@ -25,6 +26,11 @@ typedef struct udp_message {
     struct pbuf *pbuf;
     ip_addr_t addr;
     uint16_t port;
+    /*
+     * Node linking the message in its socket
+     * server's queue of pending messages.
+     */
+    sel4osapi_list_t node;
 } sel4osapi_udp_message_t;
 
 
@@ -53,8 +59,20 @@ typedef struct sel4osapi_udp_socket_server
     sel4osapi_thread_t *tx_thread;
     sel4osapi_thread_t *rx_thread;
 
-    sel4osapi_mutex_t *msgs_mutex;
+    /*
+     * Lock-free pool of received messages.
+     */
     simple_pool_t *msgs;
+    /*
+     * Messages received by udprecv, newest first
+     * (see sel4osapi_list_atomic_push).
+     */
+    sel4osapi_list_t *incoming;
+    /*
+     * Messages taken from 'incoming' in arrival order,
+     * only accessed by the socket's rx thread.
+     */
+    sel4osapi_list_head_t pending;
 
 } sel4osapi_udp_socket_server_t;
 
@@ -70,6 +88,10 @@ typedef struct sel4osapi_udpstack
     sel4osapi_mutex_t *mutex;
     seL4_CPtr stack_op_ep;
     simple_pool_t *socket_servers;
+    /*
+     * Maps socket ids to socket servers.
+     */
+    simple_handle_table_t *socket_ids;
     sel4osapi_thread_t *server_thread;
 } sel4osapi_udpstack_t;
 
@@ -78,6 +100,11 @@ typedef struct sel4osapi_udp_interface
 {
     sel4osapi_mutex_t *mutex;
     simple_pool_t *sockets;
+    /*
+     * Maps socket ids (as assigned by the
+     * udp stack) to the process' sockets.
+     */
+    simple_handle_table_t *socket_ids;
     seL4_CPtr stack_op_ep;
 } sel4osapi_udp_interface_t;
 
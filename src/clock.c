@@ -19,22 +19,97 @@
 
 #include <vka/capops.h>
 
+/*
+ * Notification registered by a client thread, which the
+ * sysclock signals when the thread's timeouts expire.
+ */
+struct timeout_notifier
+{
+    /*
+     * Copy of the client's notification cap, in the root task's CSpace.
+     */
+    seL4_CPtr aep;
+    seL4_Word caller;
+    int id;
+    /*
+     * Set once a timeout owns the notifier, which can then
+     * not be used by other timeouts.
+     */
+    int owned;
+};
+
 struct timeout_entry
 {
     seL4_Word caller;
+    /*
+     * Notification of the timeout's notifier.
+     */
     seL4_CPtr aep;
+    int notifier;
+    /*
+     * Set if the notifier was registered for this timeout only,
+     * and is unregistered along with it.
+     */
+    int owns_notifier;
     seL4_Uint32 periodic;
     seL4_Uint32 period;
     seL4_Uint32 next_event;
+    /*
+     * Nominal time of the next event, before slack is applied.
+     * Periodic timeouts advance it by their period, so that
+     * they do not drift.
+     */
+    seL4_Uint32 deadline;
+    /*
+     * How late, in milliseconds, the timeout may expire.
+     */
+    seL4_Uint32 slack;
+    /*
+     * Position of the entry in the sysclock's heap of timeouts.
+     */
+    int heap_index;
+    /*
+     * Handle of the entry in the sysclock's table of timeout ids.
+     */
+    int id;
 };
 
 typedef enum sel4osapi_sysclock_opcode
 {
     SYSCLOCK_OP_GET_TIME = 100,
     SYSCLOCK_OP_SET_TIMEOUT = 101,
-    SYSCLOCK_OP_CANCEL_TIMEOUT = 102
+    SYSCLOCK_OP_CANCEL_TIMEOUT = 102,
+    SYSCLOCK_OP_GET_TIME_NS = 103,
+    SYSCLOCK_OP_REGISTER_NOTIFIER = 104,
+    SYSCLOCK_OP_UNREGISTER_NOTIFIER = 105,
+    SYSCLOCK_OP_BATCH = 106,
+    SYSCLOCK_OP_GET_HISTOGRAM = 107
 } sel4osapi_sysclock_opcode_t;
 
+/*
+ * Flags of SYSCLOCK_OP_SET_TIMEOUT
+ */
+#define SYSCLOCK_TIMEOUT_PERIODIC   0x1
+#define SYSCLOCK_TIMEOUT_ABSOLUTE   0x2
+#define SYSCLOCK_TIMEOUT_OWN_NOTIFIER   0x4
+
+/*
+ * Size of each request of a SYSCLOCK_OP_BATCH: opcode, followed
+ * by the arguments of SYSCLOCK_OP_SET_TIMEOUT or CANCEL_TIMEOUT.
+ */
+#define SYSCLOCK_BATCH_RECORD_WORDS 6
+
+/*
+ * Badge of the root task's copies of the sysclock's EPs. User processes
+ * get copies badged with their pid, so that the server can check that
+ * notifiers and timeouts are only used by the process which created them.
+ */
+#define SYSCLOCK_ROOT_TASK_BADGE    666
+
+#if SEL4OSAPI_USER_PROCESS_MAX >= SYSCLOCK_ROOT_TASK_BADGE
+#error "SYSCLOCK_ROOT_TASK_BADGE must not be a valid pid"
+#endif
+
 #define ENABLE_TIMEOUT_SERVER   1
 
 void
@@ -42,9 +117,14 @@ timer_entry_init(void *el, void *arg)
 {
     struct timeout_entry *entry = (struct timeout_entry*) el;
     entry->aep = seL4_CapNull;
+    entry->notifier = SIMPLE_HANDLE_INVALID;
+    entry->owns_notifier = 0;
     entry->caller = 0;
     entry->period = 0;
     entry->periodic = 0;
+    entry->slack = 0;
+    entry->heap_index = -1;
+    entry->id = SIMPLE_HANDLE_INVALID;
 }
 
 int
@@ -68,20 +148,507 @@ timer_entry_compare(void *el1, void *el2)
     return 1;
 }
 
+/*
+ * Compare two points in time, allowing for the clock to wrap around.
+ */
+static inline int
+sel4osapi_sysclock_time_before(seL4_Uint32 t1, seL4_Uint32 t2)
+{
+    return ((int32_t) (t1 - t2)) < 0;
+}
+
+/*
+ * Choose when a timeout due at 'deadline' should expire, given its
+ * slack: the deadline is rounded up to a multiple of the coarsest
+ * granularity (a power-of-two number of clock periods) that fits in
+ * the slack. Timeouts due around the same time thus end up expiring
+ * on the same tick.
+ */
+static inline seL4_Uint32
+sel4osapi_sysclock_coalesce(seL4_Uint32 deadline, seL4_Uint32 slack)
+{
+    seL4_Uint32 granularity = SEL4OSAPI_SYSCLOCK_PERIOD_MS;
+
+    if (slack < granularity)
+    {
+        return deadline;
+    }
+    while (granularity <= slack / 2)
+    {
+        granularity *= 2;
+    }
+    return deadline + (granularity - deadline % granularity) % granularity;
+}
+
+/*
+ * Add a sample to a histogram: bucket 0 counts zeros, and
+ * bucket i counts values in [2^(i-1), 2^i). The last bucket
+ * also counts all larger values.
+ */
+static inline void
+sel4osapi_sysclock_histogram_record(sel4osapi_sysclock_histogram_t *histogram, uint32_t value)
+{
+    int bucket = 0;
+
+    while (bucket < SEL4OSAPI_SYSCLOCK_HISTOGRAM_BUCKETS - 1 && (value >> bucket) != 0)
+    {
+        bucket++;
+    }
+    histogram->buckets[bucket]++;
+    histogram->count++;
+    histogram->sum += value;
+    if (value > histogram->max)
+    {
+        histogram->max = value;
+    }
+}
+
+static inline void
+sel4osapi_sysclock_heap_set(sel4osapi_sysclock_t *sysclock, int index, struct timeout_entry *timeout)
+{
+    sysclock->timeouts[index] = timeout;
+    timeout->heap_index = index;
+}
+
+static void
+sel4osapi_sysclock_heap_sift_up(sel4osapi_sysclock_t *sysclock, int index)
+{
+    struct timeout_entry *timeout = sysclock->timeouts[index];
+
+    while (index > 0)
+    {
+        int parent = (index - 1) / 2;
+        if (!sel4osapi_sysclock_time_before(timeout->next_event, sysclock->timeouts[parent]->next_event))
+        {
+            break;
+        }
+        sel4osapi_sysclock_heap_set(sysclock, index, sysclock->timeouts[parent]);
+        index = parent;
+    }
+    sel4osapi_sysclock_heap_set(sysclock, index, timeout);
+}
+
+static void
+sel4osapi_sysclock_heap_sift_down(sel4osapi_sysclock_t *sysclock, int index)
+{
+    struct timeout_entry *timeout = sysclock->timeouts[index];
+
+    while (1)
+    {
+        int child = 2 * index + 1;
+        if (child >= sysclock->timeouts_num)
+        {
+            break;
+        }
+        if (child + 1 < sysclock->timeouts_num &&
+                sel4osapi_sysclock_time_before(sysclock->timeouts[child + 1]->next_event, sysclock->timeouts[child]->next_event))
+        {
+            child++;
+        }
+        if (!sel4osapi_sysclock_time_before(sysclock->timeouts[child]->next_event, timeout->next_event))
+        {
+            break;
+        }
+        sel4osapi_sysclock_heap_set(sysclock, index, sysclock->timeouts[child]);
+        index = child;
+    }
+    sel4osapi_sysclock_heap_set(sysclock, index, timeout);
+}
+
+/*
+ * Add a timeout to the schedule, in O(log n).
+ */
+static void
+sel4osapi_sysclock_heap_insert(sel4osapi_sysclock_t *sysclock, struct timeout_entry *timeout)
+{
+    assert(sysclock->timeouts_num < SEL4OSAPI_SYSCLOCK_MAX_ENTRIES);
+
+    sel4osapi_sysclock_heap_set(sysclock, sysclock->timeouts_num++, timeout);
+    sel4osapi_sysclock_heap_sift_up(sysclock, timeout->heap_index);
+}
+
+/*
+ * Remove a timeout from the schedule, in O(log n).
+ */
+static void
+sel4osapi_sysclock_heap_remove(sel4osapi_sysclock_t *sysclock, struct timeout_entry *timeout)
+{
+    int index = timeout->heap_index;
+    struct timeout_entry *last = NULL;
+
+    assert(index >= 0 && index < sysclock->timeouts_num);
+    assert(sysclock->timeouts[index] == timeout);
+
+    last = sysclock->timeouts[--sysclock->timeouts_num];
+    timeout->heap_index = -1;
+    if (last == timeout)
+    {
+        return;
+    }
+
+    sel4osapi_sysclock_heap_set(sysclock, index, last);
+    if (index > 0 && sel4osapi_sysclock_time_before(last->next_event, sysclock->timeouts[(index - 1) / 2]->next_event))
+    {
+        sel4osapi_sysclock_heap_sift_up(sysclock, index);
+    }
+    else
+    {
+        sel4osapi_sysclock_heap_sift_down(sysclock, index);
+    }
+}
+
+/*
+ * Publish the sysclock's time on the shared time page.
+ * Only called by sysclock::timer, so there is a single writer.
+ */
+static inline void
+sel4osapi_sysclock_publish_time(sel4osapi_sysclock_t *sysclock)
+{
+    sel4osapi_sysclock_time_page_t *page = sysclock->time_page;
+    uint32_t seq = page->seq;
+
+    __atomic_store_n(&page->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&page->time, sysclock->time, __ATOMIC_RELAXED);
+    __atomic_store_n(&page->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/*
+ * Read the time from a shared time page, retrying
+ * while sysclock::timer is updating it.
+ */
+static inline uint32_t
+sel4osapi_sysclock_read_time_page(sel4osapi_sysclock_time_page_t *page)
+{
+    uint32_t seq, time;
+
+    do
+    {
+        seq = __atomic_load_n(&page->seq, __ATOMIC_ACQUIRE);
+        time = __atomic_load_n(&page->time, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) || seq != __atomic_load_n(&page->seq, __ATOMIC_RELAXED));
+
+    return time;
+}
+
+/*
+ * Read the hardware timer's counter.
+ */
+static uint64_t
+sel4osapi_sysclock_read_timer(sel4osapi_sysclock_t *sysclock)
+{
+    uint64_t now_ns = 0;
+    UNUSED int error = 0;
+
+    error = sel4osapi_mutex_lock(sysclock->timer_mutex);
+    assert(!error);
+    error = ltimer_get_time(&sysclock->native_timer.ltimer, &now_ns);
+    assert(error == 0);
+    sel4osapi_mutex_unlock(sysclock->timer_mutex);
+    return now_ns;
+}
+
+/*
+ * Read the time elapsed since time 0, in nanoseconds,
+ * from the hardware timer's counter.
+ */
+static uint64_t
+sel4osapi_sysclock_read_elapsed(sel4osapi_sysclock_t *sysclock)
+{
+    uint64_t now_ns = 0;
+    UNUSED int error = 0;
+
+    /* time_base_ns is rebased under the same mutex */
+    error = sel4osapi_mutex_lock(sysclock->timer_mutex);
+    assert(!error);
+    error = ltimer_get_time(&sysclock->native_timer.ltimer, &now_ns);
+    assert(error == 0);
+    now_ns -= sysclock->time_base_ns;
+    sel4osapi_mutex_unlock(sysclock->timer_mutex);
+    return now_ns;
+}
+
+/*
+ * Delete a notifier's copy of the client's cap, and release
+ * its id and its entry. Must be called with the timeouts mutex held.
+ */
+static void
+sel4osapi_sysclock_free_notifier(sel4osapi_sysclock_t *sysclock, struct timeout_notifier *notifier)
+{
+    vka_t *vka = sel4osapi_system_get_vka();
+    cspacepath_t aep_path;
+    UNUSED int error = 0;
+
+    vka_cspace_make_path(vka, notifier->aep, &aep_path);
+    error = vka_cnode_delete(&aep_path);
+    assert(error == 0);
+    vka_cspace_free(vka, notifier->aep);
+
+    error = simple_handle_free(sysclock->notifier_ids, notifier->id);
+    assert(error == 0);
+    error = simple_pool_free(sysclock->notifiers, notifier);
+    assert(error == 0);
+}
+
+/*
+ * Remove a timeout from the schedule and release its id
+ * and its entry. The notifier stays registered, unless
+ * it was registered for this timeout only.
+ * Must be called with the timeouts mutex held.
+ */
+static void
+sel4osapi_sysclock_release_timeout(sel4osapi_sysclock_t *sysclock, struct timeout_entry *timeout)
+{
+    UNUSED int error = 0;
+
+    sel4osapi_sysclock_heap_remove(sysclock, timeout);
+    error = simple_handle_free(sysclock->timeout_ids, timeout->id);
+    assert(error == 0);
+    timeout->id = SIMPLE_HANDLE_INVALID;
+    if (timeout->owns_notifier)
+    {
+        sel4osapi_sysclock_free_notifier(sysclock,
+                simple_handle_lookup(sysclock->notifier_ids, timeout->notifier));
+        timeout->owns_notifier = 0;
+    }
+    error = simple_pool_free(sysclock->schedule, timeout);
+    assert(error == 0);
+}
+
+#if SEL4OSAPI_SYSCLOCK_TICKLESS
+/*
+ * Update the sysclock's time from the hardware timer's counter.
+ * Must be called with the timeouts mutex held.
+ */
+static uint64_t
+sel4osapi_sysclock_update_time(sel4osapi_sysclock_t *sysclock)
+{
+    uint64_t now_ns = sel4osapi_sysclock_read_timer(sysclock);
+
+    sysclock->time = (uint32_t) ((now_ns - sysclock->time_base_ns) / NS_IN_MS);
+
+    return now_ns;
+}
+
+/*
+ * Arm the hardware timer for the earliest pending timeout, if it
+ * is not already armed for it. Must be called with the timeouts
+ * mutex held.
+ */
+static void
+sel4osapi_sysclock_arm(sel4osapi_sysclock_t *sysclock)
+{
+    uint64_t now_ns, elapsed_ms, deadline_ns;
+    int32_t delay_ms;
+    UNUSED int error = 0;
+
+    if (sysclock->timeouts_num == 0)
+    {
+        return;
+    }
+    if (sysclock->armed &&
+            !sel4osapi_sysclock_time_before(sysclock->timeouts[0]->next_event, sysclock->armed_event))
+    {
+        return;
+    }
+
+    now_ns = sel4osapi_sysclock_update_time(sysclock);
+    elapsed_ms = (now_ns - sysclock->time_base_ns) / NS_IN_MS;
+    delay_ms = (int32_t) (sysclock->timeouts[0]->next_event - sysclock->time);
+    if (delay_ms < 1)
+    {
+        delay_ms = 1;
+    }
+    deadline_ns = sysclock->time_base_ns + (elapsed_ms + delay_ms) * NS_IN_MS;
+
+    error = sel4osapi_mutex_lock(sysclock->timer_mutex);
+    assert(!error);
+    error = ltimer_set_timeout(&sysclock->native_timer.ltimer, deadline_ns - now_ns, TIMEOUT_RELATIVE);
+    assert(error == 0);
+    sel4osapi_mutex_unlock(sysclock->timer_mutex);
+    sysclock->armed = 1;
+    sysclock->armed_event = sysclock->timeouts[0]->next_event;
+}
+#endif
+
+/*
+ * Add a timeout to the schedule, as described by the fields of a
+ * SYSCLOCK_OP_SET_TIMEOUT request starting at message register 'mr'
+ * (flags, period, slack, notifier id, first event).
+ * Must be called with the timeouts mutex held.
+ * Returns the new timeout's id, or SIMPLE_HANDLE_INVALID.
+ */
+static int
+sel4osapi_sysclock_add_timeout(sel4osapi_sysclock_t *sysclock, seL4_Word caller, int mr)
+{
+    seL4_Uint32 flags = sel4osapi_getMR(mr);
+    seL4_Uint32 period_ms = sel4osapi_getMR(mr + 1);
+    seL4_Uint32 slack_ms = sel4osapi_getMR(mr + 2);
+    seL4_Uint32 notifier_id = sel4osapi_getMR(mr + 3);
+    seL4_Uint32 first_ms = sel4osapi_getMR(mr + 4);
+    struct timeout_notifier *notifier = NULL;
+    struct timeout_entry *new_entry = NULL;
+
+    notifier = simple_handle_lookup(sysclock->notifier_ids, notifier_id);
+    if (notifier == NULL || notifier->caller != caller || notifier->owned)
+    {
+        syslog_error("Unknown timeout notifier %u", notifier_id);
+        return SIMPLE_HANDLE_INVALID;
+    }
+
+    new_entry = simple_pool_alloc(sysclock->schedule);
+    if (new_entry == NULL)
+    {
+        syslog_error("Failed to allocate timer entry");
+        if (flags & SYSCLOCK_TIMEOUT_OWN_NOTIFIER)
+        {
+            sel4osapi_sysclock_free_notifier(sysclock, notifier);
+        }
+        return SIMPLE_HANDLE_INVALID;
+    }
+
+    assert(new_entry->aep == seL4_CapNull);
+#if SEL4OSAPI_SYSCLOCK_TICKLESS
+    sel4osapi_sysclock_update_time(sysclock);
+#endif
+    new_entry->aep = notifier->aep;
+    new_entry->notifier = notifier->id;
+    new_entry->owns_notifier = (flags & SYSCLOCK_TIMEOUT_OWN_NOTIFIER) ? 1 : 0;
+    notifier->owned = new_entry->owns_notifier;
+    new_entry->caller = caller;
+    new_entry->period = period_ms;
+    new_entry->periodic = (flags & SYSCLOCK_TIMEOUT_PERIODIC) ? 1 : 0;
+    new_entry->slack = slack_ms;
+    /* a deadline in the past expires on the next tick */
+    new_entry->deadline = (flags & SYSCLOCK_TIMEOUT_ABSOLUTE) ? first_ms : sysclock->time + first_ms;
+    new_entry->next_event = sel4osapi_sysclock_coalesce(new_entry->deadline, slack_ms);
+    new_entry->id = simple_handle_alloc(sysclock->timeout_ids, new_entry);
+    assert(new_entry->id != SIMPLE_HANDLE_INVALID);
+    sel4osapi_sysclock_heap_insert(sysclock, new_entry);
+
+    return new_entry->id;
+}
+
+/*
+ * Cancel a timeout set by the caller. Must be called with the timeouts
+ * mutex held. Returns 1 if the timeout was pending, 0 otherwise.
+ */
+static int
+sel4osapi_sysclock_remove_timeout(sel4osapi_sysclock_t *sysclock, seL4_Word caller, seL4_Word timeout_id)
+{
+    /* a stale id (e.g. of an expired one-shot timeout) resolves to NULL */
+    struct timeout_entry *timeout = simple_handle_lookup(sysclock->timeout_ids, timeout_id);
+
+    if (timeout == NULL || timeout->caller != caller)
+    {
+        return 0;
+    }
+    sel4osapi_sysclock_release_timeout(sysclock, timeout);
+    return 1;
+}
+
 seL4_Word
-sel4osapi_sysclock_schedule_timeout(
-        seL4_Bool periodic, seL4_Uint32 timeout_ms, seL4_CPtr callback_aep)
+sel4osapi_sysclock_register_notifier(seL4_CPtr aep)
+{
+    sel4osapi_process_env_t *process = sel4osapi_process_get_current();
+    seL4_MessageInfo_t minfo;
+
+    minfo = seL4_MessageInfo_new(0,0,1,1);
+    seL4_SetCap(0, aep);
+    sel4osapi_setMR(0, SYSCLOCK_OP_REGISTER_NOTIFIER);
+
+    seL4_Call(process->sysclock_server_ep, minfo);
+    if (sel4osapi_getMR(0))
+    {
+        syslog_error("FAILED register-notifier, aep=%d", aep);
+        return 0;
+    }
+    return sel4osapi_getMR(1);
+}
+
+int
+sel4osapi_sysclock_unregister_notifier(seL4_Word notifier_id)
+{
+    sel4osapi_process_env_t *process = sel4osapi_process_get_current();
+    seL4_MessageInfo_t minfo;
+
+    minfo = seL4_MessageInfo_new(0,0,0,2);
+    sel4osapi_setMR(0, SYSCLOCK_OP_UNREGISTER_NOTIFIER);
+    sel4osapi_setMR(1, notifier_id);
+    seL4_Call(process->sysclock_server_ep, minfo);
+
+    return sel4osapi_getMR(0);
+}
+
+/*
+ * Return the id of the calling thread's notifier for the
+ * specified AEP, registering the AEP with the sysclock the
+ * first time the thread uses it. Notifiers are only released
+ * when the thread is deleted, since unregistering one cancels
+ * all the timeouts pending on it.
+ *
+ * If the thread's table of notifiers is full, a notifier is
+ * registered for a single timeout, and SYSCLOCK_TIMEOUT_OWN_NOTIFIER
+ * is added to *flags so that the server releases it along with
+ * the timeout.
+ */
+static seL4_Word
+sel4osapi_sysclock_get_notifier(seL4_CPtr callback_aep, seL4_Uint32 *flags)
+{
+    sel4osapi_thread_info_t *thread = sel4osapi_thread_get_current();
+    sel4osapi_thread_notifier_t *free_entry = NULL;
+    int i = 0;
+
+    for (i = 0; i < SEL4OSAPI_THREAD_SYSCLOCK_NOTIFIERS; ++i) {
+        sel4osapi_thread_notifier_t *entry = &thread->sysclock_notifiers[i];
+        if (entry->id != 0 && entry->aep == callback_aep)
+        {
+            return entry->id;
+        }
+        if (entry->id == 0 && free_entry == NULL)
+        {
+            free_entry = entry;
+        }
+    }
+    if (free_entry == NULL)
+    {
+        *flags |= SYSCLOCK_TIMEOUT_OWN_NOTIFIER;
+        return sel4osapi_sysclock_register_notifier(callback_aep);
+    }
+    free_entry->id = sel4osapi_sysclock_register_notifier(callback_aep);
+    free_entry->aep = callback_aep;
+
+    return free_entry->id;
+}
+
+/*
+ * Send a SYSCLOCK_OP_SET_TIMEOUT request. The first event is due
+ * first_ms milliseconds from now, or at time first_ms if the
+ * SYSCLOCK_TIMEOUT_ABSOLUTE flag is set.
+ */
+static seL4_Word
+sel4osapi_sysclock_set_timeout(seL4_Uint32 flags,
+        seL4_Uint32 first_ms, seL4_Uint32 period_ms, seL4_Uint32 slack_ms, seL4_CPtr callback_aep)
 {
     int error = 0;
     sel4osapi_process_env_t *process = sel4osapi_process_get_current();
     seL4_MessageInfo_t minfo;
     seL4_Word timeout_id;
+    seL4_Word notifier_id = sel4osapi_sysclock_get_notifier(callback_aep, &flags);
+
+    if (notifier_id == 0)
+    {
+        return 0;
+    }
 
-    minfo = seL4_MessageInfo_new(0,0,1,3);
-    seL4_SetCap(0, callback_aep);
+    minfo = seL4_MessageInfo_new(0,0,0,6);
     sel4osapi_setMR(0, SYSCLOCK_OP_SET_TIMEOUT);
-    sel4osapi_setMR(1, periodic);
-    sel4osapi_setMR(2, timeout_ms);
+    sel4osapi_setMR(1, flags);
+    sel4osapi_setMR(2, period_ms);
+    sel4osapi_setMR(3, slack_ms);
+    sel4osapi_setMR(4, notifier_id);
+    sel4osapi_setMR(5, first_ms);
 
     seL4_Call(process->sysclock_server_ep, minfo);
     error = sel4osapi_getMR(0);
@@ -98,6 +665,99 @@ sel4osapi_sysclock_schedule_timeout(
     }
 }
 
+seL4_Word
+sel4osapi_sysclock_schedule_timeout(
+        seL4_Bool periodic, seL4_Uint32 timeout_ms, seL4_CPtr callback_aep)
+{
+    return sel4osapi_sysclock_schedule_timeout_slack(periodic, timeout_ms, 0, callback_aep);
+}
+
+seL4_Word
+sel4osapi_sysclock_schedule_timeout_slack(
+        seL4_Bool periodic, seL4_Uint32 timeout_ms, seL4_Uint32 slack_ms, seL4_CPtr callback_aep)
+{
+    return sel4osapi_sysclock_set_timeout(periodic ? SYSCLOCK_TIMEOUT_PERIODIC : 0,
+            timeout_ms, timeout_ms, slack_ms, callback_aep);
+}
+
+seL4_Word
+sel4osapi_sysclock_schedule_timeout_at(
+        seL4_Bool periodic, seL4_Uint32 deadline_ms, seL4_Uint32 period_ms, seL4_CPtr callback_aep)
+{
+    return sel4osapi_sysclock_set_timeout(SYSCLOCK_TIMEOUT_ABSOLUTE | (periodic ? SYSCLOCK_TIMEOUT_PERIODIC : 0),
+            deadline_ms, period_ms, 0, callback_aep);
+}
+
+int
+sel4osapi_sysclock_submit(sel4osapi_sysclock_request_t *requests, int num)
+{
+    sel4osapi_process_env_t *process = sel4osapi_process_get_current();
+    seL4_MessageInfo_t minfo;
+    seL4_Word notifiers[SEL4OSAPI_SYSCLOCK_MAX_BATCH];
+    seL4_Uint32 notifier_flags[SEL4OSAPI_SYSCLOCK_MAX_BATCH];
+    int i = 0;
+
+    assert(requests != NULL);
+    assert(num > 0 && num <= SEL4OSAPI_SYSCLOCK_MAX_BATCH);
+
+    /* registering a notifier is a call of its own: do it
+     * before filling the message registers */
+    for (i = 0; i < num; ++i) {
+        if (requests[i].type == SEL4OSAPI_SYSCLOCK_REQUEST_SET)
+        {
+            notifier_flags[i] = 0;
+            notifiers[i] = sel4osapi_sysclock_get_notifier(requests[i].callback_aep, &notifier_flags[i]);
+        }
+    }
+
+    sel4osapi_setMR(0, SYSCLOCK_OP_BATCH);
+    sel4osapi_setMR(1, num);
+    for (i = 0; i < num; ++i) {
+        sel4osapi_sysclock_request_t *request = &requests[i];
+        int record = 2 + i * SYSCLOCK_BATCH_RECORD_WORDS;
+
+        if (request->type == SEL4OSAPI_SYSCLOCK_REQUEST_CANCEL)
+        {
+            sel4osapi_setMR(record, SYSCLOCK_OP_CANCEL_TIMEOUT);
+            sel4osapi_setMR(record + 1, request->timeout_id);
+        }
+        else
+        {
+            seL4_Uint32 flags = (request->periodic ? SYSCLOCK_TIMEOUT_PERIODIC : 0) |
+                    (request->absolute ? SYSCLOCK_TIMEOUT_ABSOLUTE : 0) | notifier_flags[i];
+            seL4_Uint32 period_ms = (request->period_ms == 0 && !request->absolute) ?
+                    request->time_ms : request->period_ms;
+
+            assert(request->type == SEL4OSAPI_SYSCLOCK_REQUEST_SET);
+            sel4osapi_setMR(record, SYSCLOCK_OP_SET_TIMEOUT);
+            sel4osapi_setMR(record + 1, flags);
+            sel4osapi_setMR(record + 2, period_ms);
+            sel4osapi_setMR(record + 3, request->slack_ms);
+            sel4osapi_setMR(record + 4, notifiers[i]);
+            sel4osapi_setMR(record + 5, request->time_ms);
+        }
+    }
+
+    minfo = seL4_MessageInfo_new(0,0,0,2 + num * SYSCLOCK_BATCH_RECORD_WORDS);
+    seL4_Call(process->sysclock_server_ep, minfo);
+
+    for (i = 0; i < num; ++i) {
+        seL4_Word result = sel4osapi_getMR(1 + i);
+
+        if (requests[i].type == SEL4OSAPI_SYSCLOCK_REQUEST_CANCEL)
+        {
+            requests[i].error = (int) result;
+        }
+        else
+        {
+            requests[i].timeout_id = result;
+            requests[i].error = (result == SIMPLE_HANDLE_INVALID) ? 1 : 0;
+        }
+    }
+
+    return sel4osapi_getMR(0);
+}
+
 int
 sel4osapi_sysclock_cancel_timeout(seL4_Word timeout_id)
 {
@@ -131,6 +791,58 @@ sel4osapi_sysclock_wait_for_timeout(seL4_Word timeout_id, seL4_CPtr callback_aep
     return wakeup_time;
 }
 
+/*
+ * Body of sysclock::time, which serves time queries on their own
+ * endpoint, so that they never queue behind timeout requests.
+ */
+void
+sel4osapi_sysclock_time_thread(sel4osapi_thread_info_t *thread)
+{
+    UNUSED int error = 0;
+    sel4osapi_sysclock_t *sysclock = (sel4osapi_sysclock_t *) thread->arg;
+
+    while (thread->active)
+    {
+        seL4_Word sender_badge;
+        seL4_MessageInfo_t minfo;
+        seL4_Uint32 opcode;
+
+        minfo = seL4_Recv(sysclock->time_ep_obj.cptr, &sender_badge);
+        assert(seL4_MessageInfo_get_length(minfo) >= 1);
+
+        opcode = sel4osapi_getMR(0);
+        assert(opcode == SYSCLOCK_OP_GET_TIME || opcode == SYSCLOCK_OP_GET_TIME_NS);
+
+        switch (opcode) {
+            case SYSCLOCK_OP_GET_TIME :
+            {
+                seL4_Uint32 time = sysclock->time;
+
+#if SEL4OSAPI_SYSCLOCK_TICKLESS
+                /* read the counter, leaving sysclock->time to the
+                 * holders of the timeouts mutex */
+                time = (seL4_Uint32) (sel4osapi_sysclock_read_elapsed(sysclock) / NS_IN_MS);
+#endif
+                minfo = seL4_MessageInfo_new(0,0,0,1);
+                sel4osapi_setMR(0, (seL4_Word) time);
+                break;
+            }
+            case SYSCLOCK_OP_GET_TIME_NS :
+            {
+                uint64_t time_ns = sel4osapi_sysclock_read_elapsed(sysclock);
+
+                /* split in two 32-bit words, whatever the word size */
+                minfo = seL4_MessageInfo_new(0,0,0,2);
+                sel4osapi_setMR(0, (seL4_Word) (time_ns & 0xffffffff));
+                sel4osapi_setMR(1, (seL4_Word) (time_ns >> 32));
+                break;
+            }
+        }
+
+        seL4_Reply(minfo);
+    }
+}
+
 void
 sel4osapi_sysclock_server_thread(sel4osapi_thread_info_t *thread)
 {
@@ -156,44 +868,21 @@ sel4osapi_sysclock_server_thread(sel4osapi_thread_info_t *thread)
         assert(seL4_MessageInfo_get_length(minfo) >= 1);
 
         opcode = sel4osapi_getMR(0);
-        assert(opcode == SYSCLOCK_OP_CANCEL_TIMEOUT || opcode == SYSCLOCK_OP_SET_TIMEOUT || opcode == SYSCLOCK_OP_GET_TIME);
+        assert(opcode == SYSCLOCK_OP_CANCEL_TIMEOUT || opcode == SYSCLOCK_OP_SET_TIMEOUT ||
+                opcode == SYSCLOCK_OP_BATCH || opcode == SYSCLOCK_OP_GET_HISTOGRAM ||
+                opcode == SYSCLOCK_OP_REGISTER_NOTIFIER || opcode == SYSCLOCK_OP_UNREGISTER_NOTIFIER);
 
         switch (opcode) {
             case SYSCLOCK_OP_CANCEL_TIMEOUT:
             {
-                UNUSED seL4_Uint32 timeout_id;
                 int done = 0;
 
                 assert(seL4_MessageInfo_get_length(minfo) == 2);
 
-                timeout_id = sel4osapi_getMR(1);
-
 #if ENABLE_TIMEOUT_SERVER
                 error = sel4osapi_mutex_lock(sysclock->timeouts_mutex);
                 assert(!error);
-                {
-                    sel4osapi_list_t *entry = sysclock->schedule->entries;
-
-                    while (entry != NULL && !done)
-                    {
-                        struct timeout_entry *timeout = (struct timeout_entry*) entry->el;
-
-                        if (timeout != NULL && ((seL4_Uint32)timeout->aep == timeout_id))
-                        {
-                            seL4_CPtr tout_aep = timeout->aep;
-                            error = simple_pool_free(sysclock->schedule, timeout);
-                            assert(error == 0);
-                            cspacepath_t aep_path;
-                            vka_cspace_make_path(vka,tout_aep, &aep_path);
-                            error = vka_cnode_revoke(&aep_path);
-                            assert(error == 0);
-                        }
-                        else
-                        {
-                            entry = entry->next;
-                        }
-                    }
-                }
+                done = sel4osapi_sysclock_remove_timeout(sysclock, sender_badge, sel4osapi_getMR(1));
                 sel4osapi_mutex_unlock(sysclock->timeouts_mutex);
 #endif
 
@@ -210,62 +899,187 @@ sel4osapi_sysclock_server_thread(sel4osapi_thread_info_t *thread)
             }
             case SYSCLOCK_OP_SET_TIMEOUT:
             {
-                seL4_CPtr reply_aep = seL4_CapNull;
-                UNUSED seL4_Uint32 timeout_ms = 0;
-                UNUSED seL4_Uint32 periodic = 0;
-                seL4_Uint32 insert_time = sysclock->time;
+                int reply_id = SIMPLE_HANDLE_INVALID;
+                seL4_Uint32 insert_time = 0;
 
-                assert(seL4_MessageInfo_get_extraCaps(minfo) == 1);
-                assert(seL4_MessageInfo_get_length(minfo) == 3);
-
-                periodic = sel4osapi_getMR(1);
-                timeout_ms = sel4osapi_getMR(2);
+                assert(seL4_MessageInfo_get_length(minfo) == 6);
 
 #if ENABLE_TIMEOUT_SERVER
                 error = sel4osapi_mutex_lock(sysclock->timeouts_mutex);
                 assert(!error);
-                struct timeout_entry *new_entry = simple_pool_alloc(sysclock->schedule);
+                reply_id = sel4osapi_sysclock_add_timeout(sysclock, sender_badge, 1);
+#if SEL4OSAPI_SYSCLOCK_TICKLESS
+                sel4osapi_sysclock_arm(sysclock);
+#endif
+                insert_time = (reply_id != SIMPLE_HANDLE_INVALID) ? sysclock->time : 0;
+                sel4osapi_mutex_unlock(sysclock->timeouts_mutex);
+#endif
+                error = (reply_id == SIMPLE_HANDLE_INVALID) ? 1 : 0;
+                minfo = seL4_MessageInfo_new(0,0,0,3);
+                sel4osapi_setMR(0, error);
+                sel4osapi_setMR(1, reply_id);
+                sel4osapi_setMR(2, insert_time);
+                break;
+            }
+            case SYSCLOCK_OP_BATCH:
+            {
+                seL4_Uint32 num = sel4osapi_getMR(1);
+                seL4_Uint32 i = 0;
+                seL4_Word results[SEL4OSAPI_SYSCLOCK_MAX_BATCH];
+                int failed = 0;
+
+                assert(num <= SEL4OSAPI_SYSCLOCK_MAX_BATCH);
+                assert(seL4_MessageInfo_get_length(minfo) == 2 + num * SYSCLOCK_BATCH_RECORD_WORDS);
+
+                /* all the requests are served under one lock,
+                 * and the hardware timer is armed only once */
+                error = sel4osapi_mutex_lock(sysclock->timeouts_mutex);
+                assert(!error);
+                for (i = 0; i < num; ++i) {
+                    int record = 2 + i * SYSCLOCK_BATCH_RECORD_WORDS;
 
-                if (new_entry == NULL)
+                    if (sel4osapi_getMR(record) == SYSCLOCK_OP_SET_TIMEOUT)
+                    {
+                        results[i] = sel4osapi_sysclock_add_timeout(sysclock, sender_badge, record + 1);
+                        failed += (results[i] == SIMPLE_HANDLE_INVALID) ? 1 : 0;
+                    }
+                    else
+                    {
+                        assert(sel4osapi_getMR(record) == SYSCLOCK_OP_CANCEL_TIMEOUT);
+                        results[i] = sel4osapi_sysclock_remove_timeout(sysclock, sender_badge, sel4osapi_getMR(record + 1)) ? 0 : 1;
+                        failed += results[i];
+                    }
+                }
+#if SEL4OSAPI_SYSCLOCK_TICKLESS
+                sel4osapi_sysclock_arm(sysclock);
+#endif
+                sel4osapi_mutex_unlock(sysclock->timeouts_mutex);
+
+                minfo = seL4_MessageInfo_new(0,0,0,1 + num);
+                sel4osapi_setMR(0, failed);
+                for (i = 0; i < num; ++i) {
+                    sel4osapi_setMR(1 + i, results[i]);
+                }
+                break;
+            }
+            case SYSCLOCK_OP_GET_HISTOGRAM:
+            {
+                seL4_Uint32 which = sel4osapi_getMR(1);
+                seL4_Uint32 reset = sel4osapi_getMR(2);
+                sel4osapi_sysclock_histogram_t histogram;
+                int i = 0;
+
+                assert(seL4_MessageInfo_get_length(minfo) == 3);
+                assert(which < SEL4OSAPI_SYSCLOCK_HISTOGRAMS);
+
+                error = sel4osapi_mutex_lock(sysclock->timeouts_mutex);
+                assert(!error);
+                histogram = sysclock->histograms[which];
+                if (reset)
                 {
-                    syslog_error("Failed to allocate timer entry");
-                    error = 1;
-                    reply_aep = seL4_CapNull;
-                    insert_time = 0;
-                    goto prepare_reply;
+                    memset(&sysclock->histograms[which], 0, sizeof(sel4osapi_sysclock_histogram_t));
                 }
+                sel4osapi_mutex_unlock(sysclock->timeouts_mutex);
 
-                assert(new_entry->aep == seL4_CapNull);
-                insert_time = sysclock->time;
-                new_entry->aep = caller_ep;
-                new_entry->caller = sender_badge;
-                new_entry->period = timeout_ms;
-                new_entry->periodic = periodic;
-                new_entry->next_event = insert_time + timeout_ms;
+                minfo = seL4_MessageInfo_new(0,0,0,4 + SEL4OSAPI_SYSCLOCK_HISTOGRAM_BUCKETS);
+                sel4osapi_setMR(0, histogram.count);
+                sel4osapi_setMR(1, histogram.max);
+                sel4osapi_setMR(2, (seL4_Word) (histogram.sum & 0xffffffff));
+                sel4osapi_setMR(3, (seL4_Word) (histogram.sum >> 32));
+                for (i = 0; i < SEL4OSAPI_SYSCLOCK_HISTOGRAM_BUCKETS; ++i) {
+                    sel4osapi_setMR(4 + i, histogram.buckets[i]);
+                }
+                break;
+            }
+            case SYSCLOCK_OP_REGISTER_NOTIFIER:
+            {
+                struct timeout_notifier *notifier = NULL;
+                int reply_id = SIMPLE_HANDLE_INVALID;
 
-                reply_aep = new_entry->aep;
-                error = 0;
+                assert(seL4_MessageInfo_get_extraCaps(minfo) == 1);
 
-        prepare_reply:
+                error = sel4osapi_mutex_lock(sysclock->timeouts_mutex);
+                assert(!error);
+                notifier = simple_pool_alloc(sysclock->notifiers);
+                if (notifier == NULL)
+                {
+                    syslog_error("Failed to allocate timeout notifier");
+                    /* empty the receive slot, so that it can take the next cap */
+                    error = vka_cnode_delete(&caller_ep_path);
+                    assert(error == 0);
+                    error = 1;
+                }
+                else
+                {
+                    /* keep the received cap: a new receive slot is allocated after replying */
+                    notifier->aep = caller_ep;
+                    notifier->caller = sender_badge;
+                    notifier->owned = 0;
+                    notifier->id = simple_handle_alloc(sysclock->notifier_ids, notifier);
+                    assert(notifier->id != SIMPLE_HANDLE_INVALID);
+                    reply_id = notifier->id;
+                    error = 0;
+                }
                 sel4osapi_mutex_unlock(sysclock->timeouts_mutex);
-#endif
-                minfo = seL4_MessageInfo_new(0,0,0,3);
+
+                minfo = seL4_MessageInfo_new(0,0,0,2);
                 sel4osapi_setMR(0, error);
-                sel4osapi_setMR(1, reply_aep);
-                sel4osapi_setMR(2, insert_time);
+                sel4osapi_setMR(1, reply_id);
                 break;
             }
-            case SYSCLOCK_OP_GET_TIME :
+            case SYSCLOCK_OP_UNREGISTER_NOTIFIER:
             {
+                struct timeout_notifier *notifier = NULL;
+                seL4_Uint32 notifier_id = 0;
+
+                assert(seL4_MessageInfo_get_length(minfo) == 2);
+
+                notifier_id = sel4osapi_getMR(1);
+
+                error = sel4osapi_mutex_lock(sysclock->timeouts_mutex);
+                assert(!error);
+                notifier = simple_handle_lookup(sysclock->notifier_ids, notifier_id);
+                if (notifier != NULL && notifier->caller != sender_badge)
+                {
+                    syslog_error("Notifier %u not registered by caller %u", notifier_id, sender_badge);
+                    notifier = NULL;
+                }
+                if (notifier != NULL)
+                {
+                    int i = 0;
+
+                    /* drop the notifier's pending timeouts (restarting the
+                     * scan after each removal, as it reorders the heap) */
+                    while (i < sysclock->timeouts_num)
+                    {
+                        if (sysclock->timeouts[i]->notifier == notifier->id)
+                        {
+                            sel4osapi_sysclock_release_timeout(sysclock, sysclock->timeouts[i]);
+                            i = 0;
+                        }
+                        else
+                        {
+                            i++;
+                        }
+                    }
+
+                    /* unless one of them owned it, and released it already */
+                    if (simple_handle_lookup(sysclock->notifier_ids, notifier_id) == notifier)
+                    {
+                        sel4osapi_sysclock_free_notifier(sysclock, notifier);
+                    }
+                }
+                sel4osapi_mutex_unlock(sysclock->timeouts_mutex);
+
                 minfo = seL4_MessageInfo_new(0,0,0,1);
-                sel4osapi_setMR(0, (seL4_Word)sysclock->time);
+                sel4osapi_setMR(0, (notifier != NULL) ? 0 : 1);
                 break;
             }
         }
 
         seL4_Reply(minfo);
 
-        if (opcode == SYSCLOCK_OP_SET_TIMEOUT)
+        if (opcode == SYSCLOCK_OP_REGISTER_NOTIFIER && error == 0)
         {
             error = vka_cspace_alloc(vka,&caller_ep);
             assert(error == 0);
@@ -275,80 +1089,199 @@ sel4osapi_sysclock_server_thread(sel4osapi_thread_info_t *thread)
     }
 }
 
+void
+sel4osapi_sysclock_get_histogram(int which, seL4_Bool reset, sel4osapi_sysclock_histogram_t *histogram_out)
+{
+    sel4osapi_process_env_t *process = sel4osapi_process_get_current();
+    seL4_MessageInfo_t minfo;
+    int i = 0;
+
+    assert(which >= 0 && which < SEL4OSAPI_SYSCLOCK_HISTOGRAMS);
+    assert(histogram_out != NULL);
+
+    minfo = seL4_MessageInfo_new(0,0,0,3);
+    sel4osapi_setMR(0, SYSCLOCK_OP_GET_HISTOGRAM);
+    sel4osapi_setMR(1, which);
+    sel4osapi_setMR(2, reset);
+    seL4_Call(process->sysclock_server_ep, minfo);
+
+    histogram_out->count = sel4osapi_getMR(0);
+    histogram_out->max = sel4osapi_getMR(1);
+    histogram_out->sum = ((uint64_t) (sel4osapi_getMR(3) & 0xffffffff) << 32) | (sel4osapi_getMR(2) & 0xffffffff);
+    for (i = 0; i < SEL4OSAPI_SYSCLOCK_HISTOGRAM_BUCKETS; ++i) {
+        histogram_out->buckets[i] = sel4osapi_getMR(4 + i);
+    }
+}
+
+void
+sel4osapi_sysclock_print_histograms(void)
+{
+    static const char *names[SEL4OSAPI_SYSCLOCK_HISTOGRAMS] = {
+        "lateness (us)", "processing (us)", "occupancy"
+    };
+    sel4osapi_sysclock_histogram_t histogram;
+    int i = 0, j = 0;
+
+    for (i = 0; i < SEL4OSAPI_SYSCLOCK_HISTOGRAMS; ++i) {
+        sel4osapi_sysclock_get_histogram(i, 0, &histogram);
+        syslog_info("%s: count=%u max=%u avg=%u", names[i],
+                histogram.count, histogram.max,
+                (histogram.count > 0) ? (unsigned int) (histogram.sum / histogram.count) : 0);
+        for (j = 0; j < SEL4OSAPI_SYSCLOCK_HISTOGRAM_BUCKETS; ++j) {
+            if (histogram.buckets[j] > 0)
+            {
+                syslog_info("  [%10u, %10u): %u",
+                        (j == 0) ? 0 : 1u << (j - 1), (j == 0) ? 1 : 1u << j,
+                        histogram.buckets[j]);
+            }
+        }
+    }
+}
+
 uint32_t
 sel4osapi_sysclock_get_time()
 {
     sel4osapi_process_env_t *process = sel4osapi_process_get_current();
-    if (process && process->sysclock_server_ep) {
+    if (process && process->sysclock_time_page) {
+        return sel4osapi_sysclock_read_time_page(process->sysclock_time_page);
+    }
+    if (process && process->sysclock_time_ep) {
         seL4_MessageInfo_t msg_info = seL4_MessageInfo_new(0,0,0,1);
         UNUSED seL4_MessageInfo_t reply_tag;
 
         seL4_SetMR(0, SYSCLOCK_OP_GET_TIME);
-        reply_tag = seL4_Call(process->sysclock_server_ep, msg_info);
+        reply_tag = seL4_Call(process->sysclock_time_ep, msg_info);
         return seL4_GetMR(0);
     }
     // Clock not initialized
     return 0;
 }
 
+uint64_t
+sel4osapi_sysclock_get_time_ns()
+{
+    sel4osapi_process_env_t *process = sel4osapi_process_get_current();
+    if (process && process->sysclock_time_ep) {
+        seL4_MessageInfo_t msg_info = seL4_MessageInfo_new(0,0,0,1);
+        UNUSED seL4_MessageInfo_t reply_tag;
+
+        seL4_SetMR(0, SYSCLOCK_OP_GET_TIME_NS);
+        reply_tag = seL4_Call(process->sysclock_time_ep, msg_info);
+        return ((uint64_t) (seL4_GetMR(1) & 0xffffffff) << 32) | (seL4_GetMR(0) & 0xffffffff);
+    }
+    // Clock not initialized
+    return 0;
+}
+
 void
 sel4osapi_sysclock_timer_thread(sel4osapi_thread_info_t *thread)
 {
     int error;
     sel4osapi_sysclock_t *sysclock = (sel4osapi_sysclock_t *)thread->arg;
     vka_t *vka = sel4osapi_system_get_vka();
+    UNUSED uint64_t pass_start_us = 0;
 
+#if SEL4OSAPI_SYSCLOCK_TICKLESS
+    syslog_trace("Sysclock is starting in tickless mode");
+#else
     syslog_trace("Sysclock is starting periodic timer with period=%d msec", SEL4OSAPI_SYSCLOCK_PERIOD_MS);
+    error = sel4osapi_mutex_lock(sysclock->timeouts_mutex);
+    assert(!error);
+    error = sel4osapi_mutex_lock(sysclock->timer_mutex);
+    assert(!error);
     error = ltimer_set_timeout(&sysclock->native_timer.ltimer, SEL4OSAPI_SYSCLOCK_PERIOD_MS * NS_IN_MS, TIMEOUT_PERIODIC);
     assert(error == 0);
+    /* ticks are counted from now: rebase the hardware counter, so that
+     * timeouts' deadlines (in ticks) and the counter share time 0 */
+    error = ltimer_get_time(&sysclock->native_timer.ltimer, &sysclock->time_base_ns);
+    assert(error == 0);
+    sysclock->time_base_ns -= (uint64_t) sysclock->time * NS_IN_MS;
+    sel4osapi_mutex_unlock(sysclock->timer_mutex);
+    sel4osapi_mutex_unlock(sysclock->timeouts_mutex);
+#endif
 
     while (thread->active)
     {
         seL4_Word sender_badge;
         seL4_Wait(sysclock->timer_aep.cptr, &sender_badge);
+#if !SEL4OSAPI_SYSCLOCK_TICKLESS
         sysclock->time += SEL4OSAPI_SYSCLOCK_PERIOD_MS;
+        sel4osapi_sysclock_publish_time(sysclock);
+#endif
 
-#if ENABLE_TIMEOUT_SERVER
         error = sel4osapi_mutex_lock(sysclock->timeouts_mutex);
         assert(!error);
-        {
-            sel4osapi_list_t *entry = sysclock->schedule->entries;
+#if SEL4OSAPI_SYSCLOCK_TICKLESS
+        /* let the ltimer account for the interrupt before reading it
+         * (the ltimer is also read by the server and time threads) */
+        error = sel4osapi_mutex_lock(sysclock->timer_mutex);
+        assert(!error);
+        sel4platsupport_handle_timer_irq(&sysclock->native_timer, sender_badge);
+        sel4osapi_mutex_unlock(sysclock->timer_mutex);
+#endif
+
+#if ENABLE_TIMEOUT_SERVER
+#if SEL4OSAPI_SYSCLOCK_TICKLESS
+        sel4osapi_sysclock_update_time(sysclock);
+        sysclock->armed = 0;
+#endif
+        pass_start_us = (sel4osapi_sysclock_read_timer(sysclock) - sysclock->time_base_ns) / NS_IN_US;
+        sel4osapi_sysclock_histogram_record(
+                &sysclock->histograms[SEL4OSAPI_SYSCLOCK_HISTOGRAM_OCCUPANCY], sysclock->timeouts_num);
 
-            while (entry != NULL)
+        /* only visit the timeouts which are due, earliest first */
+        while (sysclock->timeouts_num > 0 &&
+                !sel4osapi_sysclock_time_before(sysclock->time, sysclock->timeouts[0]->next_event))
+        {
+            struct timeout_entry *timeout = sysclock->timeouts[0];
+            seL4_MessageInfo_t msg = seL4_MessageInfo_new(0, 0, 0, 1);
+            /* lateness: the time since the timeout's next_event, both
+             * measured from time_base_ns (in periodic mode, sysclock->time
+             * lags behind the counter when ticks are missed) */
+            int64_t late_us = (int64_t) ((int32_t) ((uint32_t) (pass_start_us / US_IN_MS) - timeout->next_event)) * US_IN_MS +
+                    (int64_t) (pass_start_us % US_IN_MS);
+
+            sel4osapi_sysclock_histogram_record(
+                    &sysclock->histograms[SEL4OSAPI_SYSCLOCK_HISTOGRAM_LATENESS],
+                    (late_us > 0) ? (uint32_t) late_us : 0);
+
+            seL4_SetMR(0, sysclock->time);
+            seL4_Send(timeout->aep, msg);
+
+            if (timeout->periodic)
             {
-                struct timeout_entry *timeout = (struct timeout_entry*) entry->el;
-                sel4osapi_list_t *next = entry->next;
+                /* a zero period fires once per tick */
+                seL4_Uint32 period = (timeout->period > 0) ? timeout->period : SEL4OSAPI_SYSCLOCK_PERIOD_MS;
 
-                if (timeout != NULL && timeout->aep != seL4_CapNull && timeout->next_event <= sysclock->time)
+                /* advance from the previous deadline, skipping the
+                 * activations which were missed altogether */
+                do
                 {
-                    seL4_MessageInfo_t msg = seL4_MessageInfo_new(0, 0, 0, 1);
-                    seL4_SetMR(0, sysclock->time);
-                    seL4_Send(timeout->aep, msg);
-
-                    if (timeout->periodic)
-                    {
-                        timeout->next_event = sysclock->time + timeout->period;
-                    }
-                    else
-                    {
-                        seL4_CPtr tout_aep = timeout->aep;
-                        error = simple_pool_free(sysclock->schedule, timeout);
-                        assert(error == 0);
-                        cspacepath_t aep_path;
-                        vka_cspace_make_path(vka,tout_aep, &aep_path);
-                        error = vka_cnode_revoke(&aep_path);
-                        assert(error == 0);
-                    }
-                }
-
-                entry = next;
+                    timeout->deadline += period;
+                } while (!sel4osapi_sysclock_time_before(sysclock->time, timeout->deadline));
+                timeout->next_event = sel4osapi_sysclock_coalesce(timeout->deadline, timeout->slack);
+                sel4osapi_sysclock_heap_sift_down(sysclock, 0);
+            }
+            else
+            {
+                sel4osapi_sysclock_release_timeout(sysclock, timeout);
             }
-
         }
-        sel4osapi_mutex_unlock(sysclock->timeouts_mutex);
+#if SEL4OSAPI_SYSCLOCK_TICKLESS
+        sel4osapi_sysclock_arm(sysclock);
+#endif
+        sel4osapi_sysclock_histogram_record(
+                &sysclock->histograms[SEL4OSAPI_SYSCLOCK_HISTOGRAM_PROCESSING],
+                (uint32_t) ((sel4osapi_sysclock_read_timer(sysclock) - sysclock->time_base_ns) / NS_IN_US - pass_start_us));
 #endif
 
+#if !SEL4OSAPI_SYSCLOCK_TICKLESS
+        error = sel4osapi_mutex_lock(sysclock->timer_mutex);
+        assert(!error);
         sel4platsupport_handle_timer_irq(&sysclock->native_timer, sender_badge);
+        sel4osapi_mutex_unlock(sysclock->timer_mutex);
+#endif
+        sel4osapi_mutex_unlock(sysclock->timeouts_mutex);
     }
     sel4platsupport_destroy_timer(&sysclock->native_timer, vka);
 }
@@ -371,21 +1304,55 @@ sel4osapi_sysclock_initialize(sel4osapi_sysclock_t *sysclock)
     error = vka_alloc_endpoint(vka,&sysclock->server_ep_obj);
     assert(error == 0);
 
+    error = vka_alloc_endpoint(vka,&sysclock->time_ep_obj);
+    assert(error == 0);
+
     // syslog_trace("Allocating notification endpoint");
     error = vka_alloc_notification(vka, &sysclock->timer_aep);
     assert(error == 0);
 
     // syslog_trace("Allocating simple pool for timeouts: max_entries=%d, sizeof(each)=%d", SEL4OSAPI_SYSCLOCK_MAX_ENTRIES, sizeof(struct timeout_entry));
-    sysclock->schedule = simple_pool_new(SEL4OSAPI_SYSCLOCK_MAX_ENTRIES,sizeof(struct timeout_entry), timer_entry_init, NULL, timer_entry_compare);
+    sysclock->schedule = simple_pool_new_slab(SEL4OSAPI_SYSCLOCK_MAX_ENTRIES,sizeof(struct timeout_entry), timer_entry_init, NULL, timer_entry_compare);
     assert(sysclock->schedule != NULL);
 
+    sysclock->timeouts = (struct timeout_entry **) malloc(SEL4OSAPI_SYSCLOCK_MAX_ENTRIES * sizeof(struct timeout_entry *));
+    assert(sysclock->timeouts != NULL);
+    sysclock->timeouts_num = 0;
+
+    memset(sysclock->histograms, 0, sizeof(sysclock->histograms));
+
+    sysclock->timeout_ids = simple_handle_table_new(SEL4OSAPI_SYSCLOCK_MAX_ENTRIES);
+    assert(sysclock->timeout_ids != NULL);
+
+    sysclock->notifiers = simple_pool_new_slab(SEL4OSAPI_SYSCLOCK_MAX_NOTIFIERS, sizeof(struct timeout_notifier), NULL, NULL, NULL);
+    assert(sysclock->notifiers != NULL);
+    sysclock->notifier_ids = simple_handle_table_new(SEL4OSAPI_SYSCLOCK_MAX_NOTIFIERS);
+    assert(sysclock->notifier_ids != NULL);
+
     // syslog_trace("Getting the_default_timer...");
     error = sel4platsupport_init_default_timer_ops(vka, vspace, simple, *io_ops, sysclock->timer_aep.cptr, &sysclock->native_timer);
     assert(error == 0);
 
+    /* time is measured from now on the hardware timer's counter */
+    error = ltimer_get_time(&sysclock->native_timer.ltimer, &sysclock->time_base_ns);
+    assert(error == 0);
+
+#if SEL4OSAPI_SYSCLOCK_TICKLESS
+    sysclock->armed = 0;
+    sysclock->armed_event = 0;
+    sysclock->time_page = NULL;
+#else
+    sysclock->time_page = (sel4osapi_sysclock_time_page_t *) vspace_new_pages(vspace, seL4_AllRights, 1, PAGE_BITS_4K);
+    assert(sysclock->time_page != NULL);
+    sysclock->time_page->seq = 0;
+    sysclock->time_page->time = 0;
+#endif
+
     // syslog_trace("Creating mutex");
     sysclock->timeouts_mutex = sel4osapi_mutex_create();
     assert(sysclock->timeouts_mutex != NULL);
+    sysclock->timer_mutex = sel4osapi_mutex_create();
+    assert(sysclock->timer_mutex != NULL);
 
     // syslog_trace("Creating timer thread...");
     sysclock->timer_thread = sel4osapi_thread_create(
@@ -397,6 +1364,10 @@ sel4osapi_sysclock_initialize(sel4osapi_sysclock_t *sysclock)
                                 "sysclock::server", sel4osapi_sysclock_server_thread, sysclock, seL4_MaxPrio);
     assert(sysclock->server_thread);
 
+    sysclock->time_thread  = sel4osapi_thread_create(
+                                "sysclock::time", sel4osapi_sysclock_time_thread, sysclock, seL4_MaxPrio);
+    assert(sysclock->time_thread);
+
     /* store cap to sysclock in root task's env */
     syslog_trace("Storing sysclock cap in root task's env...");
     {
@@ -405,9 +1376,20 @@ sel4osapi_sysclock_initialize(sel4osapi_sysclock_t *sysclock)
         assert(error == 0);
         vka_cspace_make_path(vka,sysclock->server_ep_obj.cptr, &scheduler_ep_path);
         vka_cspace_make_path(vka,process->sysclock_server_ep, &minted_ep_path);
-        error = vka_cnode_mint(&minted_ep_path,&scheduler_ep_path,seL4_AllRights, 666);
+        error = vka_cnode_mint(&minted_ep_path,&scheduler_ep_path,seL4_AllRights, SYSCLOCK_ROOT_TASK_BADGE);
         assert(error == 0);
     }
+    {
+        cspacepath_t time_ep_path, minted_ep_path;
+        error = vka_cspace_alloc(vka, &process->sysclock_time_ep);
+        assert(error == 0);
+        vka_cspace_make_path(vka,sysclock->time_ep_obj.cptr, &time_ep_path);
+        vka_cspace_make_path(vka,process->sysclock_time_ep, &minted_ep_path);
+        error = vka_cnode_mint(&minted_ep_path,&time_ep_path,seL4_AllRights, SYSCLOCK_ROOT_TASK_BADGE);
+        assert(error == 0);
+    }
+    /* the root task reads the time page through the sysclock's own mapping */
+    process->sysclock_time_page = sysclock->time_page;
 
     syslog_trace("Sysclock initialized successfully");
 }
@@ -422,4 +1404,7 @@ sel4osapi_sysclock_start(sel4osapi_sysclock_t *sysclock)
 
     error = sel4osapi_thread_start(sysclock->server_thread);
     assert(error == 0);
+
+    error = sel4osapi_thread_start(sysclock->time_thread);
+    assert(error == 0);
 }
@@ -0,0 +1,147 @@
+/*
+ * FILE: handle.c - generation-counted handle table
+ *
+ * Copyright (c) 2015, Real-Time Innovations, Inc. All rights reserved.
+ *
+ * This software may be distributed and modified according to the terms of
+ * the BSD 2-Clause license. Note that NO WARRANTY is provided.
+ * See "LICENSE_BSD2.txt" for details.
+ *
+ */
+
+#include <sel4osapi/osapi.h>
+
+simple_handle_table_t*
+simple_handle_table_new(int size)
+{
+    simple_handle_table_t *table = NULL;
+    int i = 0;
+
+    assert(size > 0);
+    assert(size <= SIMPLE_HANDLE_INDEX_MASK);
+
+    table = (simple_handle_table_t *) malloc(sizeof(simple_handle_table_t));
+    assert(table != NULL);
+
+    table->objs = (void **) malloc(size * sizeof(void *));
+    assert(table->objs != NULL);
+    table->gens = (uint16_t *) malloc(size * sizeof(uint16_t));
+    assert(table->gens != NULL);
+    table->free_slots = (int *) malloc(size * sizeof(int));
+    assert(table->free_slots != NULL);
+    table->free_pos = (int *) malloc(size * sizeof(int));
+    assert(table->free_pos != NULL);
+
+    table->size = size;
+    table->current_size = 0;
+    table->free_slots_num = size;
+
+    for (i = 0; i < size; ++i) {
+        table->objs[i] = NULL;
+        table->gens[i] = 0;
+        /* lowest indices are handed out first */
+        table->free_slots[i] = size - 1 - i;
+        table->free_pos[size - 1 - i] = i;
+    }
+
+    return table;
+}
+
+int
+simple_handle_alloc(simple_handle_table_t *table, void *obj)
+{
+    int index = 0;
+
+    assert(table != NULL);
+    assert(obj != NULL);
+
+    if (table->free_slots_num == 0)
+    {
+        return SIMPLE_HANDLE_INVALID;
+    }
+
+    index = table->free_slots[--table->free_slots_num];
+    assert(table->objs[index] == NULL);
+    table->free_pos[index] = -1;
+
+    table->objs[index] = obj;
+    table->current_size++;
+
+    return SIMPLE_HANDLE(table->gens[index], index);
+}
+
+int
+simple_handle_insert(simple_handle_table_t *table, int handle, void *obj)
+{
+    int index = SIMPLE_HANDLE_INDEX(handle);
+    int pos = 0, last = 0;
+
+    assert(table != NULL);
+    assert(obj != NULL);
+
+    if (handle <= 0 || index < 0 || index >= table->size || table->objs[index] != NULL)
+    {
+        return -1;
+    }
+
+    /* take the slot off the free stack, moving
+     * the top of the stack into its position */
+    pos = table->free_pos[index];
+    assert(pos >= 0 && table->free_slots[pos] == index);
+    last = table->free_slots[--table->free_slots_num];
+    table->free_slots[pos] = last;
+    table->free_pos[last] = pos;
+    table->free_pos[index] = -1;
+
+    table->objs[index] = obj;
+    table->gens[index] = SIMPLE_HANDLE_GEN(handle);
+    table->current_size++;
+
+    return 0;
+}
+
+void*
+simple_handle_lookup(simple_handle_table_t *table, int handle)
+{
+    int index = SIMPLE_HANDLE_INDEX(handle);
+
+    assert(table != NULL);
+
+    if (handle <= 0 || index < 0 || index >= table->size)
+    {
+        return NULL;
+    }
+    if (table->gens[index] != SIMPLE_HANDLE_GEN(handle))
+    {
+        return NULL;
+    }
+    return table->objs[index];
+}
+
+int
+simple_handle_free(simple_handle_table_t *table, int handle)
+{
+    int index = SIMPLE_HANDLE_INDEX(handle);
+
+    assert(table != NULL);
+
+    if (simple_handle_lookup(table, handle) == NULL)
+    {
+        return -1;
+    }
+
+    table->objs[index] = NULL;
+    table->gens[index] = (table->gens[index] + 1) & SIMPLE_HANDLE_GEN_MASK;
+    table->free_pos[index] = table->free_slots_num;
+    table->free_slots[table->free_slots_num++] = index;
+    table->current_size--;
+
+    return 0;
+}
+
+int
+simple_handle_table_get_current_size(simple_handle_table_t *table)
+{
+    assert(table != NULL);
+    return table->current_size;
+}
@@ -40,111 +40,573 @@ sel4osapi_io_initialize(ps_io_ops_t *io_ops) {
 #ifdef CONFIG_LIB_OSAPI_SERIAL
 typedef enum sel4osapi_serial_op
 {
-    SERIAL_OP_WRITE = 201,
     SERIAL_OP_READ = 202,
-    SERIAL_OP_CONFIG = 203
+    SERIAL_OP_CONFIG = 203,
+    SERIAL_OP_FLUSH = 205
 } sel4osapi_serial_op_t;
 
+#define SEL4OSAPI_SERIAL_RX_RING_MASK   (SEL4OSAPI_SERIAL_RX_RING_SIZE - 1)
+#define SEL4OSAPI_SERIAL_TX_RING_MASK   (SEL4OSAPI_SERIAL_TX_RING_SIZE - 1)
+#define SEL4OSAPI_SERIAL_RING_MASK      (SEL4OSAPI_SERIAL_RING_SIZE - 1)
+
+/*
+ * Badges of the IRQ thread's AEP: the UART's IRQ, and
+ * the server's requests to transmit newly queued bytes.
+ */
+#define SEL4OSAPI_SERIAL_BADGE_IRQ      1
+#define SEL4OSAPI_SERIAL_BADGE_TX       2
+
+static inline void
+sel4osapi_serial_port_wake(seL4_CPtr *waiter)
+{
+    seL4_CPtr aep = seL4_CapNull;
+
+    /* pairs with the fence in sel4osapi_serial_server_serve_reads,
+     * sel4osapi_serial_server_serve_flushes and sel4osapi_serial_port_wait_tx */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    aep = __atomic_load_n(waiter, __ATOMIC_RELAXED);
+    if (aep != seL4_CapNull)
+    {
+        seL4_Signal(aep);
+    }
+}
+
+/*
+ * Drain the UART's receive FIFO into the port's ring.
+ * Returns the number of bytes received.
+ */
+static int
+sel4osapi_serial_port_receive(sel4osapi_serialport_t *port)
+{
+    uint32_t head = port->rx_head;
+    int received = 0;
+    int c = 0;
+
+    while ((c = ps_cdev_getchar(&port->dev)) != EOF)
+    {
+        if (head - __atomic_load_n(&port->rx_tail, __ATOMIC_ACQUIRE) == SEL4OSAPI_SERIAL_RX_RING_SIZE)
+        {
+            port->rx_dropped++;
+            continue;
+        }
+        port->rx_ring[head & SEL4OSAPI_SERIAL_RX_RING_MASK] = (char) c;
+        head++;
+        __atomic_store_n(&port->rx_head, head, __ATOMIC_RELEASE);
+        received++;
+    }
+    return received;
+}
+
+/*
+ * Hand the bytes queued in the port's transmit ring to the
+ * driver, in as few (contiguous) writes as possible.
+ * Returns the number of bytes transmitted.
+ */
+static int
+sel4osapi_serial_port_transmit(sel4osapi_serialport_t *port)
+{
+    uint32_t head = __atomic_load_n(&port->tx_head, __ATOMIC_ACQUIRE);
+    uint32_t tail = port->tx_tail;
+    int transmitted = 0;
+
+    while (tail != head)
+    {
+        uint32_t offset = tail & SEL4OSAPI_SERIAL_TX_RING_MASK;
+        uint32_t len = MIN(head - tail, SEL4OSAPI_SERIAL_TX_RING_SIZE - offset);
+        ssize_t written = ps_cdev_write(&port->dev, &port->tx_ring[offset], len, NULL, NULL);
+
+        if (written <= 0)
+        {
+            /* the device is busy: retry on its next interrupt */
+            break;
+        }
+        tail += written;
+        __atomic_store_n(&port->tx_tail, tail, __ATOMIC_RELEASE);
+        transmitted += written;
+    }
+    return transmitted;
+}
+
+/*
+ * Serve a port's interrupts, receiving and transmitting
+ * data through its rings, and wake up the server thread
+ * when it waits for either.
+ */
+static void
+sel4osapi_serial_irq_thread(sel4osapi_thread_info_t *thread)
+{
+    sel4osapi_serialport_t *port = (sel4osapi_serialport_t *) thread->arg;
+    seL4_Word badge;
+
+    while (thread->active)
+    {
+        seL4_Wait(port->irq_aep, &badge);
+
+        if (badge & SEL4OSAPI_SERIAL_BADGE_IRQ)
+        {
+            ps_cdev_handle_irq(&port->dev, port->dev.irqs[0]);
+            if (sel4osapi_serial_port_receive(port) > 0)
+            {
+                sel4osapi_serial_port_wake(&port->rx_waiter);
+            }
+        }
+        if (sel4osapi_serial_port_transmit(port) > 0)
+        {
+            sel4osapi_serial_port_wake(&port->tx_waiter);
+        }
+        if (badge & SEL4OSAPI_SERIAL_BADGE_IRQ)
+        {
+            seL4_IRQHandler_Ack(port->irq);
+        }
+    }
+}
+
+/*
+ * Wait until the IRQ thread has transmitted the port's
+ * bytes up to position 'until' of the transmit ring.
+ *
+ * Meanwhile the port's pending flushes are not woken up, so
+ * their waiter is signaled once we are done, to check them.
+ */
+static void
+sel4osapi_serial_port_wait_tx(sel4osapi_serialport_t *port, uint32_t until)
+{
+    seL4_CPtr aep = sel4osapi_thread_get_current()->wait_aep;
+    seL4_CPtr waiter = port->tx_waiter;
+    seL4_Word badge;
+
+    if (((int32_t) (__atomic_load_n(&port->tx_tail, __ATOMIC_ACQUIRE) - until)) >= 0)
+    {
+        return;
+    }
+
+    __atomic_store_n(&port->tx_waiter, aep, __ATOMIC_RELAXED);
+    /* pairs with the fence in sel4osapi_serial_port_wake */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    while (((int32_t) (__atomic_load_n(&port->tx_tail, __ATOMIC_ACQUIRE) - until)) < 0)
+    {
+        seL4_Wait(aep, &badge);
+    }
+    __atomic_store_n(&port->tx_waiter, waiter, __ATOMIC_RELAXED);
+    if (waiter != seL4_CapNull)
+    {
+        seL4_Signal(waiter);
+    }
+}
+
+/*
+ * Queue bytes in the port's transmit ring, waiting for room when
+ * the ring is full. Returns the position of the ring following the
+ * last queued byte, which can be passed to sel4osapi_serial_port_wait_tx.
+ */
+static uint32_t
+sel4osapi_serial_port_enqueue(sel4osapi_serialport_t *port, const char *data, uint32_t size)
+{
+    uint32_t head = port->tx_head;
+    uint32_t n = 0;
+
+    while (n < size)
+    {
+        uint32_t tail = __atomic_load_n(&port->tx_tail, __ATOMIC_ACQUIRE);
+
+        if (head - tail == SEL4OSAPI_SERIAL_TX_RING_SIZE)
+        {
+            sel4osapi_serial_port_wait_tx(port, tail + 1);
+            continue;
+        }
+        while (n < size && head - tail < SEL4OSAPI_SERIAL_TX_RING_SIZE)
+        {
+            port->tx_ring[head & SEL4OSAPI_SERIAL_TX_RING_MASK] = data[n++];
+            head++;
+        }
+        __atomic_store_n(&port->tx_head, head, __ATOMIC_RELEASE);
+        seL4_Signal(port->tx_aep);
+    }
+    return head;
+}
+
+/*
+ * Copy up to size bytes out of the port's ring.
+ */
+static uint32_t
+sel4osapi_serial_port_consume(sel4osapi_serialport_t *port, char *data, uint32_t size)
+{
+    uint32_t head = __atomic_load_n(&port->rx_head, __ATOMIC_ACQUIRE);
+    uint32_t tail = port->rx_tail;
+    uint32_t n = 0;
+
+    while (tail != head && n < size)
+    {
+        data[n++] = port->rx_ring[tail & SEL4OSAPI_SERIAL_RX_RING_MASK];
+        tail++;
+    }
+    __atomic_store_n(&port->rx_tail, tail, __ATOMIC_RELEASE);
+
+    return n;
+}
+
+/*
+ * Badges received by a port's server thread: requests on its EP carry
+ * SEL4OSAPI_SERIAL_BADGE_REQUEST plus the client's slot, while signals
+ * on its bound AEP carry one bit per client slot (whose ring became
+ * non-empty), plus the bits of the port's own events: bytes received
+ * or timeouts expired for the pending reads, and bytes transmitted
+ * for the pending flushes.
+ */
+#define SEL4OSAPI_SERIAL_BADGE_REQUEST  ((seL4_Word) 1 << 27)
+#define SEL4OSAPI_SERIAL_BADGE_SLOT(badge_) \
+    ((int) ((badge_) & ~SEL4OSAPI_SERIAL_BADGE_REQUEST))
+#define SEL4OSAPI_SERIAL_BADGE_READS    ((seL4_Word) 1 << 25)
+#define SEL4OSAPI_SERIAL_BADGE_FLUSHES  ((seL4_Word) 1 << 26)
+
+#if SEL4OSAPI_USER_PROCESS_MAX > 25
+#error "SEL4OSAPI_USER_PROCESS_MAX too large for serial client badges"
+#endif
+
+static inline sel4osapi_serialclient_port_t*
+sel4osapi_io_serial_get_client_port(sel4osapi_serialdevice_t dev)
+{
+    sel4osapi_process_env_t *process = sel4osapi_process_get_current();
+    int index = SEL4OSAPI_SERIAL_PORT_INDEX(dev);
+
+    assert(index >= 0 && index < SEL4OSAPI_SERIAL_PORTS);
+    assert(process->serial.ports[index].server_ep != seL4_CapNull);
+
+    return &process->serial.ports[index];
+}
+
+/*
+ * Wake up a ring's producer, if it is waiting for the tail to advance.
+ */
+static inline void
+sel4osapi_serial_ring_wake(sel4osapi_serial_ring_t *ring, seL4_CPtr aep)
+{
+    /* pairs with the fence in sel4osapi_serial_ring_wait */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_exchange_n(&ring->waiting, 0, __ATOMIC_RELAXED))
+    {
+        seL4_Signal(aep);
+    }
+}
+
+/*
+ * Stop serving the ring of a client which corrupted it.
+ */
+static void
+sel4osapi_serial_server_drop(sel4osapi_serialport_t *port, sel4osapi_serialclient_port_t *client)
+{
+    client->corrupt = 1;
+    port->corrupt_rings++;
+}
+
+/*
+ * Move the records queued in a client's ring to the port's transmit ring.
+ * Returns once the ring is found empty after the tail was last advanced,
+ * so that a client filling it meanwhile either sees it empty (and signals
+ * the server again) or has its records consumed.
+ *
+ * The ring's head and records are written by the client process, so they
+ * are checked before they are consumed: a client which corrupts its ring
+ * is no longer served, and is counted in the port's corrupt_rings. This is
+ * not logged, since the log may be written to this very port.
+ *
+ * If 'until' is not NULL, returns as soon as the tail reaches it (to serve
+ * a flush, while the client may keep queuing records), signaling the port's
+ * AEP on the client's behalf to drain the rest later.
+ */
+static void
+sel4osapi_serial_server_drain(sel4osapi_serialport_t *port, sel4osapi_serialclient_port_t *client, const uint32_t *until)
+{
+    sel4osapi_serial_ring_t *ring = client->ring;
+    uint32_t tail = ring->tail;
+    uint32_t head = 0;
+
+    if (client->corrupt)
+    {
+        return;
+    }
+
+    while (1)
+    {
+        head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        if (head == tail)
+        {
+            break;
+        }
+        if (head - tail > SEL4OSAPI_SERIAL_RING_SIZE)
+        {
+            sel4osapi_serial_server_drop(port, client);
+            return;
+        }
+        while (tail != head)
+        {
+            sel4osapi_serial_record_t record;
+            uint32_t offset = 0;
+            uint32_t len = 0;
+
+            if (until != NULL && ((int32_t) (tail - *until)) >= 0)
+            {
+                seL4_Signal(client->server_aep);
+                return;
+            }
+            record = *((sel4osapi_serial_record_t *) &ring->data[tail & SEL4OSAPI_SERIAL_RING_MASK]);
+            offset = (tail + sizeof(record)) & SEL4OSAPI_SERIAL_RING_MASK;
+            len = MIN(record.len, SEL4OSAPI_SERIAL_RING_SIZE - offset);
+
+            if (record.len > SEL4OSAPI_SERIAL_RING_MAX_RECORD ||
+                    ((int32_t) (head - tail)) < (int32_t) (sizeof(record) + ROUND_UP_UNSAFE(record.len, 4)))
+            {
+                sel4osapi_serial_server_drop(port, client);
+                return;
+            }
+            if (record.dev == port->id)
+            {
+                /* records may wrap around the end of the ring */
+                sel4osapi_serial_port_enqueue(port, &ring->data[offset], len);
+                if (len < record.len)
+                {
+                    sel4osapi_serial_port_enqueue(port, ring->data, record.len - len);
+                }
+            }
+            tail += sizeof(record) + ROUND_UP_UNSAFE(record.len, 4);
+            __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+            sel4osapi_serial_ring_wake(ring, client->client_aep);
+        }
+        /* pairs with the fence in sel4osapi_io_serial_write_async */
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    }
+}
+
+/*
+ * Complete a client's pending read with the bytes copied so far.
+ */
+static void
+sel4osapi_serial_server_complete_read(sel4osapi_serialport_t *port, sel4osapi_serialclient_port_t *client)
+{
+    if (client->read_timeout_id != 0)
+    {
+        /* if the timeout already expired, its signal
+         * only causes an extra scan of the pending reads */
+        sel4osapi_sysclock_cancel_timeout(client->read_timeout_id);
+        client->read_timeout_id = 0;
+    }
+    client->read_size = 0;
+    port->reads_pending--;
+
+    __atomic_store_n(&client->ring->read_len, client->read_count, __ATOMIC_RELEASE);
+    seL4_Signal(client->read_aep);
+}
+
+/*
+ * Copy the bytes received on the port to the clients' pending reads,
+ * completing the reads which are satisfied or past their deadline.
+ * While reads are pending, the IRQ thread signals the port's AEP
+ * (with SEL4OSAPI_SERIAL_BADGE_READS) when it receives new bytes.
+ */
+static void
+sel4osapi_serial_server_serve_reads(sel4osapi_serialport_t *port)
+{
+    sel4osapi_serialserver_t *server = port->server;
+    int index = SEL4OSAPI_SERIAL_PORT_INDEX(port->id);
+    uint32_t now = 0;
+    int slot = 0;
+
+    if (port->reads_pending == 0)
+    {
+        return;
+    }
+
+    __atomic_store_n(&port->rx_waiter, port->reads_aep, __ATOMIC_RELAXED);
+    /* pairs with the fence in sel4osapi_serial_port_wake: either
+     * the IRQ thread sees the waiter, or we see its bytes */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    now = sel4osapi_sysclock_get_time();
+    for (slot = 0; slot < SEL4OSAPI_USER_PROCESS_MAX && port->reads_pending > 0; ++slot) {
+        sel4osapi_serialclient_port_t *client = NULL;
+
+        if (server->slots[slot] == NULL || server->slots[slot]->ports[index].read_size == 0)
+        {
+            continue;
+        }
+        client = &server->slots[slot]->ports[index];
+        client->read_count += sel4osapi_serial_port_consume(port,
+                (char *) client->buf + client->read_count, client->read_size - client->read_count);
+        if (client->read_count == client->read_size ||
+                (client->read_timeout_id != 0 && ((int32_t) (now - client->read_deadline)) >= 0))
+        {
+            sel4osapi_serial_server_complete_read(port, client);
+        }
+    }
+
+    if (port->reads_pending == 0)
+    {
+        __atomic_store_n(&port->rx_waiter, seL4_CapNull, __ATOMIC_RELAXED);
+    }
+}
+
+/*
+ * Complete a client's pending flush.
+ */
+static void
+sel4osapi_serial_server_complete_flush(sel4osapi_serialport_t *port, sel4osapi_serialclient_port_t *client)
+{
+    client->flush_pending = 0;
+    port->flushes_pending--;
+
+    __atomic_store_n(&client->ring->flushed, client->flush_ticket, __ATOMIC_RELEASE);
+    seL4_Signal(client->flush_aep);
+}
+
+/*
+ * Complete the clients' pending flushes whose bytes were all transmitted.
+ * While flushes are pending, the IRQ thread signals the port's AEP
+ * (with SEL4OSAPI_SERIAL_BADGE_FLUSHES) when it transmits bytes.
+ */
+static void
+sel4osapi_serial_server_serve_flushes(sel4osapi_serialport_t *port)
+{
+    sel4osapi_serialserver_t *server = port->server;
+    int index = SEL4OSAPI_SERIAL_PORT_INDEX(port->id);
+    uint32_t tail = 0;
+    int slot = 0;
+
+    if (port->flushes_pending == 0)
+    {
+        return;
+    }
+
+    __atomic_store_n(&port->tx_waiter, port->flushes_aep, __ATOMIC_RELAXED);
+    /* pairs with the fence in sel4osapi_serial_port_wake: either
+     * the IRQ thread sees the waiter, or we see its progress */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    tail = __atomic_load_n(&port->tx_tail, __ATOMIC_ACQUIRE);
+    for (slot = 0; slot < SEL4OSAPI_USER_PROCESS_MAX && port->flushes_pending > 0; ++slot) {
+        sel4osapi_serialclient_port_t *client = NULL;
+
+        if (server->slots[slot] == NULL || !server->slots[slot]->ports[index].flush_pending)
+        {
+            continue;
+        }
+        client = &server->slots[slot]->ports[index];
+        if (((int32_t) (tail - client->flush_until)) >= 0)
+        {
+            sel4osapi_serial_server_complete_flush(port, client);
+        }
+    }
+
+    if (port->flushes_pending == 0)
+    {
+        __atomic_store_n(&port->tx_waiter, seL4_CapNull, __ATOMIC_RELAXED);
+    }
+}
+
+/*
+ * Serve the requests of all clients on a single port.
+ */
 void
 sel4osapi_serial_server_thread(sel4osapi_thread_info_t *thread)
 {
-    sel4osapi_serialserver_t *server = (sel4osapi_serialserver_t *)thread->arg;
+    sel4osapi_serialport_t *port = (sel4osapi_serialport_t *)thread->arg;
+    sel4osapi_serialserver_t *server = port->server;
+    int index = SEL4OSAPI_SERIAL_PORT_INDEX(port->id);
     seL4_Word sender_badge;
-    seL4_Word mr0, mr1, mr2, mr3;
+    seL4_Word mr0, mr1;
     seL4_MessageInfo_t minfo;
-    int client_id = 0;
     sel4osapi_serial_op_t opcode  = 0;
-    sel4osapi_serialdevice_t devid = 0;
     uint32_t op_size = 0;
     sel4osapi_serialclient_t *client = NULL;
-    ps_chardevice_t *device = NULL;
+    sel4osapi_serialclient_port_t *client_port = NULL;
+    int slot = 0;
 
     syslog_trace("started serving requests...");
 
     while (thread->active)
     {
-            minfo = seL4_Recv(server->server_ep, &sender_badge);
-            assert(seL4_MessageInfo_get_length(minfo) == 4);
-            mr0 = seL4_GetMR(0);
-            mr1 = seL4_GetMR(1);
-            mr2 = seL4_GetMR(2);
-            mr3 = seL4_GetMR(3);
-
-            client_id = mr0;
-            opcode = mr1;
-            devid = mr2;
-
-            sel4osapi_list_t *cursor = server->clients->entries;
-            while (cursor != NULL)
+            minfo = seL4_Recv(port->server_ep, &sender_badge);
+            if (!(sender_badge & SEL4OSAPI_SERIAL_BADGE_REQUEST))
             {
-                client = (sel4osapi_serialclient_t*) cursor->el;
-                if (client->id == client_id)
+                /* a signal on the bound AEP: one badge bit per client
+                 * whose ring became non-empty */
+                for (slot = 0; slot < SEL4OSAPI_USER_PROCESS_MAX; ++slot) {
+                    if ((sender_badge & ((seL4_Word) 1 << slot)) && server->slots[slot] != NULL)
+                    {
+                        sel4osapi_serial_server_drain(port, &server->slots[slot]->ports[index], NULL);
+                    }
+                }
+                if (sender_badge & SEL4OSAPI_SERIAL_BADGE_READS)
                 {
-                    break;
+                    sel4osapi_serial_server_serve_reads(port);
+                }
+                if (sender_badge & SEL4OSAPI_SERIAL_BADGE_FLUSHES)
+                {
+                    sel4osapi_serial_server_serve_flushes(port);
                 }
-                client = NULL;
-                cursor = cursor->next;
+                continue;
             }
-            assert(client);
-            assert(op_size <= client->buf_size);
+            assert(seL4_MessageInfo_get_length(minfo) == 2);
+            mr0 = seL4_GetMR(0);
+            mr1 = seL4_GetMR(1);
 
-            switch (devid) {
-                case SERIAL_DEV_UART1:
-                    device = &server->uart1;
-                    break;
-                case SERIAL_DEV_UART2:
-                    device = &server->uart2;
-                    break;
-                default:
-                    device = NULL;
-                    break;
-            }
-            assert(device);
+            opcode = mr0;
+
+            /* the badge was minted for the client's slot */
+            slot = SEL4OSAPI_SERIAL_BADGE_SLOT(sender_badge);
+            assert(slot < SEL4OSAPI_USER_PROCESS_MAX);
+            client = server->slots[slot];
+            assert(client);
+            client_port = &client->ports[index];
 
             switch (opcode) {
-                case SERIAL_OP_WRITE: {
-                    int i;
-                    op_size = mr3;
-                    for (i = 0; i < op_size; ++i) {
-                        ps_cdev_putchar(device, ((char *)client->buf)[i]);
-                    }
-                    mr0 = op_size;
-                    minfo = seL4_MessageInfo_new(0,0,0,1);
-                    seL4_SetMR(0, mr0);
-                    seL4_Reply(minfo);
+                case SERIAL_OP_FLUSH: {
+                    /* sent without waiting for a reply: move what the client
+                     * queued up to the ticket (MR1) to the port, and keep the
+                     * flush pending until it is all transmitted */
+                    op_size = mr1;
+                    assert(!client_port->flush_pending);
+                    sel4osapi_serial_server_drain(port, client_port, &op_size);
+
+                    client_port->flush_ticket = op_size;
+                    client_port->flush_until = port->tx_head;
+                    client_port->flush_pending = 1;
+                    port->flushes_pending++;
+                    sel4osapi_serial_server_serve_flushes(port);
                     break;
                 }
 
                 case SERIAL_OP_READ: {
-                    int i;
-                    int ret = EOF;
-                    uint32_t tStart, tNow;
-                    op_size = mr3;
-                    size_t timeout = *((size_t *)client->buf);
-                    tStart = sel4osapi_sysclock_get_time();
-                    for (i = 0; i < op_size; ++i) {
-                        while (ret == EOF) {
-                            tNow = sel4osapi_sysclock_get_time();
-                            if ((timeout > 0) && ((tNow - tStart) > timeout)) {
-                                break;
-                            }
-                            ret = ps_cdev_getchar(device);
-                        }
-                        if (ret == EOF) {
-                            break;
-                        }
-                        ((char *)(client->buf))[i] = ret;
+                    /* sent without waiting for a reply: the read stays pending
+                     * (while the port keeps serving other requests) until it is
+                     * completed by the bytes received, or by its timeout */
+                    size_t timeout = *((size_t *)client_port->buf);
+                    op_size = mr1;
+                    assert(op_size <= client_port->buf_size);
+                    assert(client_port->read_size == 0);
+
+                    client_port->read_size = op_size;
+                    client_port->read_count = 0;
+                    client_port->read_timeout_id = 0;
+                    port->reads_pending++;
+                    if (op_size == 0)
+                    {
+                        sel4osapi_serial_server_complete_read(port, client_port);
+                        break;
                     }
 
-                    mr0 = i;
-                    minfo = seL4_MessageInfo_new(0,0,0,1);
-                    seL4_SetMR(0, mr0);
-                    seL4_Reply(minfo);
+                    sel4osapi_serial_server_serve_reads(port);
+                    if (client_port->read_size != 0 && timeout > 0)
+                    {
+                        client_port->read_deadline = sel4osapi_sysclock_get_time() + timeout;
+                        client_port->read_timeout_id = sel4osapi_sysclock_schedule_timeout_at(0,
+                                client_port->read_deadline, 0, port->reads_aep);
+                        assert(client_port->read_timeout_id != 0);
+                    }
                     break;
                 }
                 case SERIAL_OP_CONFIG: {
-                    sel4osapi_serial_config_t *config = (sel4osapi_serial_config_t *)client->buf;
-                    mr0 = serial_configure(device, config->bps, config->char_size, config->parity, config->stop_bit);
+                    sel4osapi_serial_config_t *config = (sel4osapi_serial_config_t *)client_port->buf;
+                    mr0 = serial_configure(&port->dev, config->bps, config->char_size, config->parity, config->stop_bit);
                     minfo = seL4_MessageInfo_new(0,0,0,1);
                     seL4_SetMR(0, mr0);
                     seL4_Reply(minfo);
@@ -156,67 +618,169 @@ sel4osapi_serial_server_thread(sel4osapi_thread_info_t *thread)
 
 }
 
+/*
+ * Wait until the tail of the process' ring reaches position 'until'.
+ * Called with the ring's lock held.
+ */
+static void
+sel4osapi_serial_ring_wait(sel4osapi_serialclient_port_t *client, uint32_t until)
+{
+    sel4osapi_serial_ring_t *ring = client->ring;
+    seL4_Word badge;
+
+    while (((int32_t) (__atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) - until)) < 0)
+    {
+        __atomic_store_n(&ring->waiting, 1, __ATOMIC_RELAXED);
+        /* pairs with the fence in sel4osapi_serial_ring_wake */
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (((int32_t) (__atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) - until)) >= 0)
+        {
+            break;
+        }
+        seL4_Wait(client->client_aep, &badge);
+    }
+    __atomic_store_n(&ring->waiting, 0, __ATOMIC_RELAXED);
+}
+
 int
 sel4osapi_io_serial_write(sel4osapi_serialdevice_t dev, void *data, uint32_t size)
 {
-    seL4_MessageInfo_t minfo;
-    seL4_Word mr0, mr1, mr2, mr3;
-    sel4osapi_process_env_t *process = sel4osapi_process_get_current();
-    sel4osapi_serialclient_t *client = &process->serial;
+    uint32_t ticket = 0;
+    int written = 0;
 
-    assert(size <= client->buf_size);
+    written = sel4osapi_io_serial_write_async(dev, data, size, &ticket);
+    sel4osapi_io_serial_flush(dev, ticket);
 
-    sel4osapi_semaphore_take(client->buf_avail, 0);
+    return written;
+}
 
-    memcpy(client->buf, data, size);
+int
+sel4osapi_io_serial_write_async(sel4osapi_serialdevice_t dev, void *data, uint32_t size, uint32_t *ticket_out)
+{
+    sel4osapi_serialclient_port_t *client = sel4osapi_io_serial_get_client_port(dev);
+    sel4osapi_serial_ring_t *ring = client->ring;
+    uint32_t head = 0;
+    uint32_t queued = 0;
+    int error = 0;
 
-    mr0 = client->id;
-    mr1 = SERIAL_OP_WRITE;
-    mr2 = dev;
-    mr3 = size;
-    seL4_SetMR(0, mr0);
-    seL4_SetMR(1, mr1);
-    seL4_SetMR(2, mr2);
-    seL4_SetMR(3, mr3);
-    minfo = seL4_MessageInfo_new(0,0,0,4);
+    error = sel4osapi_mutex_lock(client->ring_lock);
+    assert(!error);
 
-    minfo = seL4_Call(client->server_ep, minfo);
-    assert(seL4_MessageInfo_get_length(minfo) == 1);
-    mr0 = seL4_GetMR(0);
+    head = ring->head;
+    while (queued < size)
+    {
+        sel4osapi_serial_record_t record;
+        uint32_t record_size = 0;
+        uint32_t offset = 0;
+        uint32_t len = 0;
 
-    sel4osapi_semaphore_give(client->buf_avail);
+        record.dev = dev;
+        record.len = MIN(size - queued, SEL4OSAPI_SERIAL_RING_MAX_RECORD);
+        record_size = sizeof(record) + ROUND_UP_UNSAFE(record.len, 4);
 
-    return mr0;
+        /* wait for the server to make room for the record */
+        sel4osapi_serial_ring_wait(client, head + record_size - SEL4OSAPI_SERIAL_RING_SIZE);
+
+        *((sel4osapi_serial_record_t *) &ring->data[head & SEL4OSAPI_SERIAL_RING_MASK]) = record;
+        offset = (head + sizeof(record)) & SEL4OSAPI_SERIAL_RING_MASK;
+        len = MIN(record.len, SEL4OSAPI_SERIAL_RING_SIZE - offset);
+        memcpy(&ring->data[offset], (char *) data + queued, len);
+        memcpy(ring->data, (char *) data + queued + len, record.len - len);
+
+        __atomic_store_n(&ring->head, head + record_size, __ATOMIC_RELEASE);
+        /* pairs with the fence in sel4osapi_serial_server_drain: only
+         * signal the server when the ring was empty, i.e. when it may
+         * have stopped draining it */
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&ring->tail, __ATOMIC_RELAXED) == head)
+        {
+            seL4_Signal(client->server_aep);
+        }
+
+        head += record_size;
+        queued += record.len;
+    }
+
+    sel4osapi_mutex_unlock(client->ring_lock);
+
+    if (ticket_out != NULL)
+    {
+        *ticket_out = head;
+    }
+
+    return queued;
+}
+
+int
+sel4osapi_io_serial_flush(sel4osapi_serialdevice_t dev, uint32_t ticket)
+{
+    seL4_MessageInfo_t minfo;
+    seL4_Word mr0, mr1;
+    sel4osapi_serialclient_port_t *client = sel4osapi_io_serial_get_client_port(dev);
+    seL4_Word badge;
+    int error = 0;
+
+    /* the server drains the ring up to the ticket itself: the ring's
+     * lock is not held, so that the process' other threads can keep
+     * queuing writes meanwhile */
+    error = sel4osapi_mutex_lock(client->flush_lock);
+    assert(!error);
+
+    if (ticket == SEL4OSAPI_SERIAL_FLUSH_ALL)
+    {
+        ticket = __atomic_load_n(&client->ring->head, __ATOMIC_ACQUIRE);
+    }
+
+    /* nothing to do if a later flush already covered the ticket */
+    if (((int32_t) (__atomic_load_n(&client->ring->flushed, __ATOMIC_ACQUIRE) - ticket)) < 0)
+    {
+        mr0 = SERIAL_OP_FLUSH;
+        mr1 = ticket;
+        seL4_SetMR(0, mr0);
+        seL4_SetMR(1, mr1);
+        minfo = seL4_MessageInfo_new(0,0,0,2);
+
+        /* the server completes the flush by signaling flush_aep */
+        seL4_Send(client->server_ep, minfo);
+        while (((int32_t) (__atomic_load_n(&client->ring->flushed, __ATOMIC_ACQUIRE) - ticket)) < 0)
+        {
+            seL4_Wait(client->flush_aep, &badge);
+        }
+    }
+
+    sel4osapi_mutex_unlock(client->flush_lock);
+
+    return 0;
 }
 
 int
 sel4osapi_io_serial_read(sel4osapi_serialdevice_t dev, void *data, uint32_t size, size_t timeout)
 {
     seL4_MessageInfo_t minfo;
-    seL4_Word mr0, mr1, mr2, mr3;
-    sel4osapi_process_env_t *process = sel4osapi_process_get_current();
-    sel4osapi_serialclient_t *client = &process->serial;
+    seL4_Word mr0, mr1;
+    sel4osapi_serialclient_port_t *client = sel4osapi_io_serial_get_client_port(dev);
     size_t *ptrTimeout;
+    seL4_Word badge;
 
     assert(size <= client->buf_size);
 
-    sel4osapi_semaphore_take(client->buf_avail, 0);
+    sel4osapi_semaphore_take(client->buf_avail, SEL4OSAPI_WAIT_FOREVER);
     ptrTimeout = (size_t *)client->buf;
     *ptrTimeout = timeout;
+    __atomic_store_n(&client->ring->read_len, SEL4OSAPI_SERIAL_READ_PENDING, __ATOMIC_RELAXED);
 
-    mr0 = client->id;
-    mr1 = SERIAL_OP_READ;
-    mr2 = dev;
-    mr3 = size;
+    mr0 = SERIAL_OP_READ;
+    mr1 = size;
     seL4_SetMR(0, mr0);
     seL4_SetMR(1, mr1);
-    seL4_SetMR(2, mr2);
-    seL4_SetMR(3, mr3);
-    minfo = seL4_MessageInfo_new(0,0,0,4);
+    minfo = seL4_MessageInfo_new(0,0,0,2);
 
-    minfo = seL4_Call(client->server_ep, minfo);
-    assert(seL4_MessageInfo_get_length(minfo) == 1);
-    mr0 = seL4_GetMR(0);
+    /* the server completes the read by signaling read_aep */
+    seL4_Send(client->server_ep, minfo);
+    while ((mr0 = __atomic_load_n(&client->ring->read_len, __ATOMIC_ACQUIRE)) == SEL4OSAPI_SERIAL_READ_PENDING)
+    {
+        seL4_Wait(client->read_aep, &badge);
+    }
 
     if (mr0 > 0)
     {
@@ -236,27 +800,22 @@ sel4osapi_io_serial_configure(sel4osapi_serialdevice_t dev,
         int  stop_bit)
 {
     seL4_MessageInfo_t minfo;
-    seL4_Word mr0, mr1, mr2, mr3;
-    sel4osapi_process_env_t *process = sel4osapi_process_get_current();
-    sel4osapi_serialclient_t *client = &process->serial;
+    seL4_Word mr0, mr1;
+    sel4osapi_serialclient_port_t *client = sel4osapi_io_serial_get_client_port(dev);
     sel4osapi_serial_config_t *config;
 
-    sel4osapi_semaphore_take(client->buf_avail, 0);
+    sel4osapi_semaphore_take(client->buf_avail, SEL4OSAPI_WAIT_FOREVER);
     config = (sel4osapi_serial_config_t *)client->buf;
     config->bps = bps;
     config->char_size = char_size;
     config->parity = (enum serial_parity)parity;
     config->stop_bit = stop_bit;
 
-    mr0 = client->id;
-    mr1 = SERIAL_OP_CONFIG;
-    mr2 = dev;
-    mr3 = sizeof(sel4osapi_serial_config_t);
+    mr0 = SERIAL_OP_CONFIG;
+    mr1 = sizeof(sel4osapi_serial_config_t);
     seL4_SetMR(0, mr0);
     seL4_SetMR(1, mr1);
-    seL4_SetMR(2, mr2);
-    seL4_SetMR(3, mr3);
-    minfo = seL4_MessageInfo_new(0,0,0,4);
+    minfo = seL4_MessageInfo_new(0,0,0,2);
 
     minfo = seL4_Call(client->server_ep, minfo);
     assert(seL4_MessageInfo_get_length(minfo) == 1);
@@ -270,69 +829,229 @@ sel4osapi_serialclient_t *
 sel4osapi_io_serial_create_client(sel4osapi_serialserver_t *server)
 {
     vspace_t *vspace = sel4osapi_system_get_vspace();
+    vka_t *vka = sel4osapi_system_get_vka();
     sel4osapi_serialclient_t *client = NULL;
+    cspacepath_t src_path, badged_path;
+    vka_object_t client_aep_obj = { 0 };
+    int slot = 0;
+    int i = 0;
+    int error = 0;
 
     client = simple_pool_alloc(server->clients);
     assert(client);
 
-    client->id = simple_pool_get_current_size(server->clients);
+    client->id = simple_handle_alloc(server->client_ids, client);
+    assert(client->id != SIMPLE_HANDLE_INVALID);
+
+    /* the client identifies itself to the ports with its slot */
+    slot = SIMPLE_HANDLE_INDEX(client->id);
+    assert(slot < SEL4OSAPI_USER_PROCESS_MAX);
+    server->slots[slot] = client;
+
+    for (i = 0; i < SEL4OSAPI_SERIAL_PORTS; ++i) {
+        sel4osapi_serialport_t *port = &server->ports[i];
+        sel4osapi_serialclient_port_t *client_port = &client->ports[i];
+
+        memset(client_port, 0, sizeof(sel4osapi_serialclient_port_t));
+        if (port->thread == NULL)
+        {
+            continue;
+        }
+
+        client_port->buf_avail = sel4osapi_semaphore_create(1);
+        assert(client_port->buf_avail);
+
+        client_port->buf = vspace_new_pages(vspace, seL4_AllRights, SEL4OSAPI_SERIAL_SHM_PAGES, PAGE_BITS_4K);
+        assert(client_port->buf != NULL);
+        client_port->buf_size = SEL4OSAPI_SERIAL_BUF_SIZE;
 
-    client->buf_avail = sel4osapi_semaphore_create(1);
-    assert(client->buf_avail);
+        client_port->ring = (sel4osapi_serial_ring_t *) ((char *) client_port->buf + SEL4OSAPI_SERIAL_BUF_SIZE);
+        client_port->ring->head = 0;
+        client_port->ring->tail = 0;
+        client_port->ring->waiting = 0;
+        client_port->ring->read_len = 0;
+        client_port->ring->flushed = 0;
 
-    client->buf = vspace_new_pages(vspace, seL4_AllRights, SEL4OSAPI_SERIAL_BUF_PAGES, PAGE_BITS_4K);
-    assert(client->buf != NULL);
-    client->buf_size = SEL4OSAPI_SERIAL_BUF_SIZE;
+        error = vka_cspace_alloc(vka, &client_port->server_ep);
+        assert(error == 0);
+        vka_cspace_make_path(vka, port->server_ep, &src_path);
+        vka_cspace_make_path(vka, client_port->server_ep, &badged_path);
+        error = vka_cnode_mint(&badged_path, &src_path, seL4_AllRights, SEL4OSAPI_SERIAL_BADGE_REQUEST | slot);
+        assert(error == 0);
 
-    client->server_ep = server->server_ep;
+        error = vka_cspace_alloc(vka, &client_port->server_aep);
+        assert(error == 0);
+        vka_cspace_make_path(vka, port->server_aep.cptr, &src_path);
+        vka_cspace_make_path(vka, client_port->server_aep, &badged_path);
+        error = vka_cnode_mint(&badged_path, &src_path, seL4_AllRights, (seL4_Word) 1 << slot);
+        assert(error == 0);
+
+        error = vka_alloc_notification(vka, &client_aep_obj);
+        assert(error == 0);
+        client_port->client_aep = client_aep_obj.cptr;
+
+        error = vka_alloc_notification(vka, &client_aep_obj);
+        assert(error == 0);
+        client_port->read_aep = client_aep_obj.cptr;
+
+        error = vka_alloc_notification(vka, &client_aep_obj);
+        assert(error == 0);
+        client_port->flush_aep = client_aep_obj.cptr;
+    }
 
     return client;
 }
 
+#if defined(CONFIG_LIB_OSAPI_SERIAL_UART1) || defined(CONFIG_LIB_OSAPI_SERIAL_UART2)
+/*
+ * Open a serial port, route its IRQ to the port's IRQ thread,
+ * and create the port's server thread.
+ */
+static void
+sel4osapi_io_serial_port_initialize(sel4osapi_serialserver_t *server,
+        sel4osapi_serialdevice_t devid, enum chardev_id id, const char *name, int priority)
+{
+    sel4osapi_serialport_t *port = &server->ports[SEL4OSAPI_SERIAL_PORT_INDEX(devid)];
+    simple_t *simple = sel4osapi_system_get_simple();
+    vka_t *vka = sel4osapi_system_get_vka();
+    ps_io_ops_t *io_ops = sel4osapi_system_get_io_ops();
+    vka_object_t irq_aep_obj = { 0 };
+    cspacepath_t irq_path = { 0 }, aep_path = { 0 }, badged_path = { 0 };
+    seL4_CPtr irq_badged_aep = seL4_CapNull;
+    ps_chardevice_t *chardev;
+    char tname[SEL4OSAPI_THREAD_NAME_MAX_LEN];
+    int error = 0;
+
+    port->server = server;
+    port->id = devid;
+
+    chardev = ps_cdev_init(id, io_ops, &port->dev);
+    assert(chardev);
+    assert(port->dev.irqs != NULL);
+
+    port->rx_head = 0;
+    port->rx_tail = 0;
+    port->rx_dropped = 0;
+    port->rx_waiter = seL4_CapNull;
+    port->tx_head = 0;
+    port->tx_tail = 0;
+    port->tx_waiter = seL4_CapNull;
+    port->corrupt_rings = 0;
+
+    error = vka_cspace_alloc(vka, &port->irq);
+    assert(error == 0);
+    vka_cspace_make_path(vka, port->irq, &irq_path);
+
+    error = simple_get_IRQ_handler(simple, port->dev.irqs[0], irq_path);
+    assert(error == 0);
+
+    error = vka_alloc_notification(vka, &irq_aep_obj);
+    assert(error == 0);
+
+    port->irq_aep = irq_aep_obj.cptr;
+    vka_cspace_make_path(vka, port->irq_aep, &aep_path);
+
+    /* the IRQ and the server signal the same AEP, with different badges */
+    error = vka_cspace_alloc(vka, &irq_badged_aep);
+    assert(error == 0);
+    vka_cspace_make_path(vka, irq_badged_aep, &badged_path);
+    error = vka_cnode_mint(&badged_path, &aep_path, seL4_AllRights, SEL4OSAPI_SERIAL_BADGE_IRQ);
+    assert(error == 0);
+
+    error = vka_cspace_alloc(vka, &port->tx_aep);
+    assert(error == 0);
+    vka_cspace_make_path(vka, port->tx_aep, &badged_path);
+    error = vka_cnode_mint(&badged_path, &aep_path, seL4_AllRights, SEL4OSAPI_SERIAL_BADGE_TX);
+    assert(error == 0);
+
+    error = seL4_IRQHandler_SetNotification(irq_path.capPtr, irq_badged_aep);
+    assert(error == 0);
+
+    snprintf(tname, SEL4OSAPI_THREAD_NAME_MAX_LEN, "%s::irq", name);
+    port->irq_thread = sel4osapi_thread_create(tname, sel4osapi_serial_irq_thread, port, priority);
+    assert(port->irq_thread);
+
+    port->server_ep = vka_alloc_endpoint_leaky(vka);
+    assert(port->server_ep != seL4_CapNull);
+
+    error = vka_alloc_notification(vka, &port->server_aep);
+    assert(error == 0);
+    vka_cspace_make_path(vka, port->server_aep.cptr, &aep_path);
+
+    /* events of the port's pending reads and flushes */
+    error = vka_cspace_alloc(vka, &port->reads_aep);
+    assert(error == 0);
+    vka_cspace_make_path(vka, port->reads_aep, &badged_path);
+    error = vka_cnode_mint(&badged_path, &aep_path, seL4_AllRights, SEL4OSAPI_SERIAL_BADGE_READS);
+    assert(error == 0);
+    port->reads_pending = 0;
+
+    error = vka_cspace_alloc(vka, &port->flushes_aep);
+    assert(error == 0);
+    vka_cspace_make_path(vka, port->flushes_aep, &badged_path);
+    error = vka_cnode_mint(&badged_path, &aep_path, seL4_AllRights, SEL4OSAPI_SERIAL_BADGE_FLUSHES);
+    assert(error == 0);
+    port->flushes_pending = 0;
+
+    port->thread = sel4osapi_thread_create(name, sel4osapi_serial_server_thread, port, priority);
+    assert(port->thread);
+
+    /* signals on the bound AEP are received by seL4_Recv on the EP */
+    error = seL4_TCB_BindNotification(port->thread->native.tcb.cptr, port->server_aep.cptr);
+    assert(error == 0);
+}
+
+static void
+sel4osapi_io_serial_port_start(sel4osapi_serialport_t *port)
+{
+    int error = 0;
+
+    error = sel4osapi_thread_start(port->irq_thread);
+    assert(!error);
+
+    error = sel4osapi_thread_start(port->thread);
+    assert(!error);
+}
+#endif
+
 void
 sel4osapi_io_serial_initialize(sel4osapi_serialserver_t *server, int priority)
 {
     int error = 0;
-    ps_chardevice_t *chardev;
 
     vspace_t *vspace = sel4osapi_system_get_vspace();
     simple_t *simple = sel4osapi_system_get_simple();
     vka_t *vka = sel4osapi_system_get_vka();
-#if defined(CONFIG_LIB_OSAPI_SERIAL_UART1) || defined(CONFIG_LIB_OSAPI_SERIAL_UART2)
-    ps_io_ops_t *io_ops = sel4osapi_system_get_io_ops();
-#endif
 
     error = platsupport_serial_setup_simple(vspace, simple, vka);
     assert(error == 0);
 
+    memset(server->ports, 0, sizeof(server->ports));
+    memset(server->slots, 0, sizeof(server->slots));
+
 #ifdef CONFIG_LIB_OSAPI_SERIAL_UART1
     /*Open serial port one */
-    chardev = ps_cdev_init(PS_SERIAL0, io_ops, &server->uart1);
-    assert(chardev);
-    //serial_configure(chardev, 9600, 8, PARITY_ODD, 1);
-    
+    sel4osapi_io_serial_port_initialize(server, SERIAL_DEV_UART1, PS_SERIAL0, "serial::uart1", priority);
+    //serial_configure(&server->ports[0].dev, 9600, 8, PARITY_ODD, 1);
 #endif
 
 #ifdef CONFIG_LIB_OSAPI_SERIAL_UART2
     /*Open serial port two*/
-    chardev = ps_cdev_init(PS_SERIAL1, io_ops, &server->uart2);
-    assert(chardev);
+    sel4osapi_io_serial_port_initialize(server, SERIAL_DEV_UART2, PS_SERIAL1, "serial::uart2", priority);
 #endif
 
     server->clients = simple_pool_new(SEL4OSAPI_USER_PROCESS_MAX, sizeof(sel4osapi_serialclient_t), NULL, NULL, NULL);
     assert(server->clients);
 
-    server->mutex = sel4osapi_mutex_create();
-    assert(server->mutex);
-
-    server->server_ep = vka_alloc_endpoint_leaky(vka);
-    assert(server->server_ep != seL4_CapNull);
-
-    server->thread = sel4osapi_thread_create("serial", sel4osapi_serial_server_thread, server, priority);
-    assert(server->thread);
+    server->client_ids = simple_handle_table_new(SEL4OSAPI_USER_PROCESS_MAX);
+    assert(server->client_ids);
 
-    error = sel4osapi_thread_start(server->thread);
-    assert(!error);
+#ifdef CONFIG_LIB_OSAPI_SERIAL_UART1
+    sel4osapi_io_serial_port_start(&server->ports[SEL4OSAPI_SERIAL_PORT_INDEX(SERIAL_DEV_UART1)]);
+#endif
+#ifdef CONFIG_LIB_OSAPI_SERIAL_UART2
+    sel4osapi_io_serial_port_start(&server->ports[SEL4OSAPI_SERIAL_PORT_INDEX(SERIAL_DEV_UART2)]);
+#endif
 }
 
 #endif
@@ -25,23 +25,31 @@ sel4osapi_ipcserver_initialize(sel4osapi_ipcserver_t *ipc)
     ipc->clients = simple_pool_new(SEL4OSAPI_USER_PROCESS_MAX, sizeof(sel4osapi_ipcclient_t), NULL, NULL, NULL);
     assert(ipc->clients);
 
+    ipc->client_ids = simple_handle_table_new(SEL4OSAPI_USER_PROCESS_MAX);
+    assert(ipc->client_ids);
+
     syslog_trace("ipc server initialized.");
 
     return 0;
 }
 
 sel4osapi_ipcclient_t*
-sel4osapi_ipc_create_client(sel4osapi_ipcserver_t *ipc, int id)
+sel4osapi_ipc_create_client(sel4osapi_ipcserver_t *ipc)
 {
     vspace_t *vspace = sel4osapi_system_get_vspace();
     sel4osapi_ipcclient_t * client = NULL;
+    UNUSED int error = 0;
 
-    assert(id >= 0);
+    error = sel4osapi_mutex_lock(ipc->mutex);
+    assert(!error);
 
     client = (sel4osapi_ipcclient_t*) simple_pool_alloc(ipc->clients);
     assert(client != NULL);
 
-    client->id = id;
+    client->id = simple_handle_alloc(ipc->client_ids, client);
+    assert(client->id != SIMPLE_HANDLE_INVALID);
+
+    sel4osapi_mutex_unlock(ipc->mutex);
 
     client->rx_buf_avail = sel4osapi_semaphore_create(1);
     assert(client->rx_buf_avail);
@@ -58,3 +66,17 @@ sel4osapi_ipc_create_client(sel4osapi_ipcserver_t *ipc, int id)
 
     return client;
 }
+
+sel4osapi_ipcclient_t*
+sel4osapi_ipc_get_client(sel4osapi_ipcserver_t *ipc, int id)
+{
+    sel4osapi_ipcclient_t *client = NULL;
+    UNUSED int error = 0;
+
+    error = sel4osapi_mutex_lock(ipc->mutex);
+    assert(!error);
+    client = (sel4osapi_ipcclient_t*) simple_handle_lookup(ipc->client_ids, id);
+    sel4osapi_mutex_unlock(ipc->mutex);
+
+    return client;
+}
@@ -93,6 +93,125 @@ sel4osapi_list_unlink(sel4osapi_list_t * head, sel4osapi_list_t *node)
     return head;
 }
 
+void
+sel4osapi_list_head_init(sel4osapi_list_head_t *list)
+{
+    assert(list != NULL);
+
+    list->head = NULL;
+    list->tail = NULL;
+    list->count = 0;
+}
+
+void
+sel4osapi_list_head_append(sel4osapi_list_head_t *list, sel4osapi_list_t *node)
+{
+    assert(list != NULL);
+    assert(node != NULL);
+
+    node->next = NULL;
+    node->prev = list->tail;
+    if (list->tail != NULL)
+    {
+        list->tail->next = node;
+    }
+    else
+    {
+        list->head = node;
+    }
+    list->tail = node;
+    list->count++;
+}
+
+void
+sel4osapi_list_head_prepend(sel4osapi_list_head_t *list, sel4osapi_list_t *node)
+{
+    assert(list != NULL);
+    assert(node != NULL);
+
+    node->prev = NULL;
+    node->next = list->head;
+    if (list->head != NULL)
+    {
+        list->head->prev = node;
+    }
+    else
+    {
+        list->tail = node;
+    }
+    list->head = node;
+    list->count++;
+}
+
+void
+sel4osapi_list_head_unlink(sel4osapi_list_head_t *list, sel4osapi_list_t *node)
+{
+    assert(list != NULL);
+    assert(node != NULL);
+    assert(list->count > 0);
+
+    if (node->prev != NULL)
+    {
+        node->prev->next = node->next;
+    }
+    else
+    {
+        assert(list->head == node);
+        list->head = node->next;
+    }
+    if (node->next != NULL)
+    {
+        node->next->prev = node->prev;
+    }
+    else
+    {
+        assert(list->tail == node);
+        list->tail = node->prev;
+    }
+
+    node->prev = NULL;
+    node->next = NULL;
+    list->count--;
+}
+
+sel4osapi_list_t*
+sel4osapi_list_head_pop(sel4osapi_list_head_t *list)
+{
+    sel4osapi_list_t *node = NULL;
+
+    assert(list != NULL);
+
+    node = list->head;
+    if (node != NULL)
+    {
+        sel4osapi_list_head_unlink(list, node);
+    }
+    return node;
+}
+
+void
+sel4osapi_list_atomic_push(sel4osapi_list_t **top, sel4osapi_list_t *node)
+{
+    sel4osapi_list_t *next = NULL;
+
+    assert(top != NULL);
+    assert(node != NULL);
+
+    /* no ABA problem: nodes are only ever removed all at once */
+    next = __atomic_load_n(top, __ATOMIC_RELAXED);
+    do {
+        node->next = next;
+    } while (!__atomic_compare_exchange_n(top, &next, node, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+sel4osapi_list_t*
+sel4osapi_list_atomic_take(sel4osapi_list_t **top)
+{
+    assert(top != NULL);
+
+    return __atomic_exchange_n(top, NULL, __ATOMIC_ACQUIRE);
+}
+
 int
 sel4osapi_list_to_array(sel4osapi_list_t *list, void **array, int array_len_max, int *array_len_out)
 {
@@ -30,6 +30,8 @@ sel4osapi_syslog_monitoring_thread(sel4osapi_thread_info_t *thread)
     {
         printf("[syslog][MONITORING][%s]\n",monitored->info.name);
         seL4_Wait(monitored->fault_endpoint,&sender);
+        /* write the faulting thread's last queued messages first */
+        sel4osapi_log_flush();
         printf("[syslog][FAULT][%s]\n",monitored->info.name);
         fflush(stdout);
         /*printf("[syslog][%s][RESTARTING]\n",monitored->info.name);
@@ -66,12 +68,232 @@ sel4osapi_log_set_level(sel4osapi_loglevel_t level)
     sel4osapi_gv_loglevel = level;
 }
 
+static inline void __syslog_outMessage(char *buf, size_t len) {
+    if (sel4osapi_logconsole) {
+        sel4osapi_io_serial_write(sel4osapi_logconsole, buf, len);
+    } else {
+        fwrite(buf, 1, len, stdout);
+        fflush(stdout);
+    }
+}
+
+#if SEL4OSAPI_LOG_ASYNC
+
+#if (SEL4OSAPI_LOG_RING_LINES & (SEL4OSAPI_LOG_RING_LINES - 1)) != 0
+#error "SEL4OSAPI_LOG_RING_LINES must be a power of two"
+#endif
+
+#define SEL4OSAPI_LOG_DRAIN_THREAD_NAME     "syslog::drain"
+
+/*
+ * Size of the batches of lines written by the drain thread.
+ */
+#define SEL4OSAPI_LOG_BATCH_SIZE            (4 * SEL4OSAPI_LOG_LINE_MAX)
+
+typedef struct sel4osapi_log_entry
+{
+    /*
+     * Position for which the entry can be claimed by a producer,
+     * or position + 1 once its line is ready to be drained.
+     */
+    uint32_t seq;
+    uint32_t len;
+    char text[SEL4OSAPI_LOG_LINE_MAX];
+} sel4osapi_log_entry_t;
+
+/*
+ * Bounded multi-producer ring of formatted lines. Producers claim
+ * an entry by advancing head, and format their line directly into
+ * it. Lines are consumed by the holder of sel4osapi_gv_logmutex
+ * (the drain thread, or sel4osapi_log_flush), advancing tail.
+ */
+typedef struct sel4osapi_log_ring
+{
+    uint32_t head;
+    uint32_t tail;
+    /*
+     * Set by the drain thread before it waits on aep
+     */
+    uint32_t waiting;
+    /*
+     * Lines dropped because the ring was full
+     */
+    uint32_t dropped;
+    sel4osapi_thread_t *thread;
+    seL4_CPtr aep;
+    sel4osapi_log_entry_t entries[SEL4OSAPI_LOG_RING_LINES];
+} sel4osapi_log_ring_t;
+
+static sel4osapi_log_ring_t sel4osapi_gv_logring;
+
+/*
+ * Claim the entry for the next line. Returns NULL (and counts
+ * the line as dropped) if the ring is full.
+ */
+static sel4osapi_log_entry_t *
+sel4osapi_log_ring_claim(sel4osapi_log_ring_t *ring, uint32_t *pos_out)
+{
+    uint32_t pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+
+    while (1)
+    {
+        sel4osapi_log_entry_t *entry = &ring->entries[pos & (SEL4OSAPI_LOG_RING_LINES - 1)];
+        int32_t diff = (int32_t) (__atomic_load_n(&entry->seq, __ATOMIC_ACQUIRE) - pos);
+
+        if (diff == 0)
+        {
+            if (__atomic_compare_exchange_n(&ring->head, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                *pos_out = pos;
+                return entry;
+            }
+        }
+        else if (diff < 0)
+        {
+            __atomic_fetch_add(&ring->dropped, 1, __ATOMIC_RELAXED);
+            return NULL;
+        }
+        else
+        {
+            pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static void
+sel4osapi_log_ring_publish(sel4osapi_log_ring_t *ring, sel4osapi_log_entry_t *entry, uint32_t pos)
+{
+    __atomic_store_n(&entry->seq, pos + 1, __ATOMIC_RELEASE);
+
+    /* pairs with the fence in sel4osapi_log_drain_thread */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&ring->waiting, __ATOMIC_RELAXED) &&
+            __atomic_exchange_n(&ring->waiting, 0, __ATOMIC_RELAXED))
+    {
+        seL4_Signal(ring->aep);
+    }
+}
+
+static inline int
+sel4osapi_log_ring_ready(sel4osapi_log_ring_t *ring)
+{
+    uint32_t pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+    sel4osapi_log_entry_t *entry = &ring->entries[pos & (SEL4OSAPI_LOG_RING_LINES - 1)];
+
+    return __atomic_load_n(&entry->seq, __ATOMIC_ACQUIRE) == pos + 1;
+}
+
+/*
+ * Write all queued lines to the console, in batches.
+ * Must be called with sel4osapi_gv_logmutex held.
+ */
+static void
+sel4osapi_log_ring_drain(sel4osapi_log_ring_t *ring)
+{
+    static char batch[SEL4OSAPI_LOG_BATCH_SIZE];
+    size_t len = 0;
+    uint32_t dropped = 0;
+
+    dropped = __atomic_exchange_n(&ring->dropped, 0, __ATOMIC_RELAXED);
+    if (dropped > 0)
+    {
+        len = snprintf(batch, SEL4OSAPI_LOG_BATCH_SIZE, "[syslog] %u messages dropped\n", (unsigned int) dropped);
+    }
+
+    while (sel4osapi_log_ring_ready(ring))
+    {
+        uint32_t pos = ring->tail;
+        sel4osapi_log_entry_t *entry = &ring->entries[pos & (SEL4OSAPI_LOG_RING_LINES - 1)];
+
+        if (len + entry->len > SEL4OSAPI_LOG_BATCH_SIZE)
+        {
+            __syslog_outMessage(batch, len);
+            len = 0;
+        }
+        memcpy(batch + len, entry->text, entry->len);
+        len += entry->len;
+
+        /* hand the entry back to the producers, for the next lap */
+        __atomic_store_n(&entry->seq, pos + SEL4OSAPI_LOG_RING_LINES, __ATOMIC_RELEASE);
+        __atomic_store_n(&ring->tail, pos + 1, __ATOMIC_RELAXED);
+    }
+
+    if (len > 0)
+    {
+        __syslog_outMessage(batch, len);
+    }
+}
+
+static void
+sel4osapi_log_drain_thread(sel4osapi_thread_info_t *thread)
+{
+    sel4osapi_log_ring_t *ring = (sel4osapi_log_ring_t *) thread->arg;
+    seL4_Word badge;
+
+    while (thread->active)
+    {
+        sel4osapi_log_lock();
+        sel4osapi_log_ring_drain(ring);
+        sel4osapi_log_unlock();
+
+        __atomic_store_n(&ring->waiting, 1, __ATOMIC_RELAXED);
+        /* pairs with the fence in sel4osapi_log_ring_publish */
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (sel4osapi_log_ring_ready(ring) || __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED))
+        {
+            __atomic_store_n(&ring->waiting, 0, __ATOMIC_RELAXED);
+            continue;
+        }
+        /* a stale signal only causes an extra (empty) pass */
+        seL4_Wait(ring->aep, &badge);
+    }
+}
+
+static int
+sel4osapi_log_start_drain(void)
+{
+    sel4osapi_log_ring_t *ring = &sel4osapi_gv_logring;
+    sel4osapi_thread_t *thread = NULL;
+    uint32_t i = 0;
+
+    for (i = 0; i < SEL4OSAPI_LOG_RING_LINES; ++i) {
+        ring->entries[i].seq = i;
+    }
+    ring->head = 0;
+    ring->tail = 0;
+    ring->waiting = 0;
+    ring->dropped = 0;
+
+    thread = sel4osapi_thread_create(SEL4OSAPI_LOG_DRAIN_THREAD_NAME,
+            sel4osapi_log_drain_thread, ring, SEL4OSAPI_LOG_DRAIN_PRIORITY);
+    if (thread == NULL)
+    {
+        return -1;
+    }
+    ring->aep = thread->info.wait_aep;
+
+    /* lines are queued only once the drain thread is running */
+    if (sel4osapi_thread_start(thread) != 0)
+    {
+        return -1;
+    }
+    __atomic_store_n(&ring->thread, thread, __ATOMIC_RELEASE);
+    return 0;
+}
+
+#endif
+
 int
 sel4osapi_log_initialize()
 {
     if (!sel4osapi_gv_logmutex) {
         sel4osapi_gv_logmutex = sel4osapi_mutex_create();
         assert(sel4osapi_gv_logmutex != NULL);
+#if SEL4OSAPI_LOG_ASYNC
+        if (sel4osapi_log_start_drain() != 0) {
+            syslog_warn("failed to start the log thread, logging synchronously");
+        }
+#endif
     } else {
         syslog_warn("OSAPI Syslog initialized more than once, ignoring subsequent initializations...");
     }
@@ -96,16 +318,57 @@ sel4osapi_log_unlock()
     }
 }
 
-#define SYSLOG_BUFFER_MAX_SIZE      4096
-static inline void __syslog_outMessage(char *buf, size_t len) {
-    if (sel4osapi_logconsole) {
-        sel4osapi_io_serial_write(sel4osapi_logconsole, buf, len);
-        sel4osapi_io_serial_write(sel4osapi_logconsole, "\n", 1);
+void
+sel4osapi_log_flush()
+{
+#if SEL4OSAPI_LOG_ASYNC
+    sel4osapi_log_ring_t *ring = &sel4osapi_gv_logring;
+
+    if (__atomic_load_n(&ring->thread, __ATOMIC_ACQUIRE) != NULL) {
+        sel4osapi_log_lock();
+        sel4osapi_log_ring_drain(ring);
+        sel4osapi_log_unlock();
+    }
+#endif
+}
+
+/*
+ * Format a message's header and text into buf, followed by a newline.
+ * Returns the length of the line, truncated to fit in size bytes.
+ */
+static size_t
+__syslog_formatMessage(char *buf, size_t size,
+                       const char *levelStr,
+                       const char *file,
+                       const char *function,
+                       const int line,
+                       const char *msg, va_list ap) {
+    size_t len;
+    int res;
+    if (sel4osapi_gv_logmutex) {
+        res = snprintf(buf, size - 1, "[%s][%03d][%s:%d][%s][%5s] ",
+                sel4osapi_thread_get_current()->name,
+                sel4osapi_thread_get_current()->priority,
+                strlen(file) > 30?file+(strlen(file)-30):file,
+                line,
+                function,
+                levelStr);
     } else {
-        puts(buf);
+        res = snprintf(buf, size - 1, "[N/A][0][%s:%d][%s][%5s] ",
+                        strlen(file) > 30?file+(strlen(file)-30):file,
+                        line,
+                        function,
+                        levelStr);
     }
+    len = MIN((size_t) MAX(res, 0), size - 2);
+    res = vsnprintf(buf + len, size - 1 - len, msg, ap);
+    len = MIN(len + MAX(res, 0), size - 2);
+    buf[len++] = '\n';
+    buf[len] = '\0';
+    return len;
 }
 
+#define SYSLOG_BUFFER_MAX_SIZE      4096
 
 void __syslog_logMessage(sel4osapi_loglevel_t level,
                          const char *levelStr,
@@ -118,30 +381,41 @@ void __syslog_logMessage(sel4osapi_loglevel_t level,
     size_t len;
     if (sel4osapi_gv_loglevel >= level) {
         va_start(ap, msg);
+#if SEL4OSAPI_LOG_ASYNC
+        /* errors are written synchronously, so that they are not lost
+         * if the system goes down right after them */
+        if (level != SEL4OSAPI_LOG_LEVEL_ERROR &&
+                __atomic_load_n(&sel4osapi_gv_logring.thread, __ATOMIC_ACQUIRE) != NULL) {
+            sel4osapi_log_ring_t *ring = &sel4osapi_gv_logring;
+            sel4osapi_log_entry_t *entry;
+            uint32_t pos;
+
+            /* format straight into the claimed entry, without locking */
+            entry = sel4osapi_log_ring_claim(ring, &pos);
+            if (entry != NULL) {
+                entry->len = __syslog_formatMessage(entry->text, SEL4OSAPI_LOG_LINE_MAX,
+                        levelStr, file, function, line, msg, ap);
+                sel4osapi_log_ring_publish(ring, entry, pos);
+            }
+            va_end(ap);
+            return;
+        }
+#endif
         if (sel4osapi_gv_logmutex) {
             sel4osapi_log_lock();
-            len = snprintf(buffer, SYSLOG_BUFFER_MAX_SIZE, "[%s][%03d][%s:%d][%s][%5s] ",
-                    sel4osapi_thread_get_current()->name,
-                    sel4osapi_thread_get_current()->priority,
-                    strlen(file) > 30?file+(strlen(file)-30):file,
-                    line,
-                    function,
-                    levelStr);
-        } else {
-            len = snprintf(buffer, SYSLOG_BUFFER_MAX_SIZE, "[N/A][0][%s:%d][%s][%5s] ",
-                            strlen(file) > 30?file+(strlen(file)-30):file,
-                            line,
-                            function,
-                            levelStr);
         }
-
-        len += vsnprintf(buffer+len, SYSLOG_BUFFER_MAX_SIZE - len, msg, ap);
+#if SEL4OSAPI_LOG_ASYNC
+        /* keep the messages in order */
+        if (__atomic_load_n(&sel4osapi_gv_logring.thread, __ATOMIC_ACQUIRE) != NULL) {
+            sel4osapi_log_ring_drain(&sel4osapi_gv_logring);
+        }
+#endif
+        len = __syslog_formatMessage(buffer, SYSLOG_BUFFER_MAX_SIZE,
+                levelStr, file, function, line, msg, ap);
         __syslog_outMessage(buffer, len);
         if (sel4osapi_gv_logmutex) {
             sel4osapi_log_unlock();
         }
+        va_end(ap);
     }
 }
-
-
-
@@ -11,14 +11,293 @@
 
 #include <sel4osapi/osapi.h>
 
+#include <sync/mutex.h>
+
+/*
+ * The first page of a large allocation starts with a header.
+ */
+#define SEL4OSAPI_HEAP_PAGE_MAGIC           0x48454150
+#define SEL4OSAPI_HEAP_PAGE_HEADER_SIZE     16
+
+typedef struct sel4osapi_heap_page
+{
+    uint32_t magic;
+    uint32_t num_pages;
+} sel4osapi_heap_page_t;
+
+typedef struct sel4osapi_heap_class
+{
+    /*
+     * Free blocks, linked through their first word
+     */
+    void *free_blocks;
+    sel4osapi_heap_class_stats_t stats;
+} sel4osapi_heap_class_t;
+
+/*
+ * Pages of the size classes are mapped in a range of the vspace
+ * reserved for them, and carved into blocks with no header: the
+ * size class of each page is kept in a side table.
+ */
+typedef struct sel4osapi_heap
+{
+    vspace_t *vspace;
+    sync_mutex_t mutex;
+    sel4osapi_heap_class_t classes[SEL4OSAPI_HEAP_CLASSES + 1];
+    reservation_t reservation;
+    char *pages_base;
+    /*
+     * Pages of the range mapped so far
+     */
+    unsigned int pages_used;
+    uint8_t page_class[SEL4OSAPI_HEAP_PAGES];
+} sel4osapi_heap_t;
+
+static sel4osapi_heap_t sel4osapi_gv_heap;
+
+#define sel4osapi_heap_page_of(ptr_) \
+    ((sel4osapi_heap_page_t *) ((seL4_Word) (ptr_) & ~((seL4_Word) PAGE_SIZE_4K - 1)))
+
+#define sel4osapi_heap_owns_page(heap_, ptr_) \
+    ((char *) (ptr_) >= (heap_)->pages_base && \
+     (char *) (ptr_) < (heap_)->pages_base + SEL4OSAPI_HEAP_PAGES * PAGE_SIZE_4K)
+
+void
+sel4osapi_heap_initialize(vspace_t *vspace, vka_t *vka)
+{
+    sel4osapi_heap_t *heap = &sel4osapi_gv_heap;
+    void *pages_base = NULL;
+    UNUSED int error = 0;
+    int i = 0;
+
+    assert(vspace != NULL);
+    assert(vka != NULL);
+
+    error = sync_mutex_new(vka, &heap->mutex);
+    assert(error == 0);
+
+    for (i = 0; i <= SEL4OSAPI_HEAP_CLASSES; ++i) {
+        memset(&heap->classes[i], 0, sizeof(sel4osapi_heap_class_t));
+        if (i < SEL4OSAPI_HEAP_CLASSES)
+        {
+            heap->classes[i].stats.block_size = 1 << (SEL4OSAPI_HEAP_MIN_CLASS_BITS + i);
+        }
+    }
+
+    /* only reserves the addresses: pages are mapped on demand */
+    heap->reservation = vspace_reserve_range(vspace, SEL4OSAPI_HEAP_PAGES * PAGE_SIZE_4K,
+            seL4_AllRights, 1, &pages_base);
+    assert(heap->reservation.res);
+    heap->pages_base = (char *) pages_base;
+    heap->pages_used = 0;
+    memset(heap->page_class, SEL4OSAPI_HEAP_CLASS_LARGE, sizeof(heap->page_class));
+
+    heap->vspace = vspace;
+}
+
+static int
+sel4osapi_heap_size_class(size_t size)
+{
+    int size_class = 0;
+
+    while (size_class < SEL4OSAPI_HEAP_CLASSES &&
+            ((size_t) 1 << (SEL4OSAPI_HEAP_MIN_CLASS_BITS + size_class)) < size)
+    {
+        size_class++;
+    }
+    return size_class;
+}
+
+/*
+ * Map the next page of the heap's range for a size class,
+ * and carve it into free blocks.
+ */
+static int
+sel4osapi_heap_refill(sel4osapi_heap_t *heap, int size_class)
+{
+    sel4osapi_heap_class_t *hclass = &heap->classes[size_class];
+    size_t block_size = hclass->stats.block_size;
+    char *page = NULL;
+    char *block = NULL;
+    unsigned int num_blocks = 0;
+
+    if (heap->pages_used == SEL4OSAPI_HEAP_PAGES)
+    {
+        return -1;
+    }
+    page = heap->pages_base + heap->pages_used * PAGE_SIZE_4K;
+    if (vspace_new_pages_at_vaddr(heap->vspace, page, 1, PAGE_BITS_4K, heap->reservation) != 0)
+    {
+        return -1;
+    }
+    heap->page_class[heap->pages_used++] = size_class;
+
+    /* blocks fill the whole page, aligned to their size */
+    block = page;
+    while (block + block_size <= page + PAGE_SIZE_4K)
+    {
+        *((void **) block) = hclass->free_blocks;
+        hclass->free_blocks = block;
+        block += block_size;
+        num_blocks++;
+    }
+
+    hclass->stats.pages++;
+    hclass->stats.blocks += num_blocks;
+    return 0;
+}
+
+static void*
+sel4osapi_heap_allocate_large(sel4osapi_heap_t *heap, size_t size)
+{
+    sel4osapi_heap_class_stats_t *stats = &heap->classes[SEL4OSAPI_HEAP_CLASS_LARGE].stats;
+    sel4osapi_heap_page_t *page = NULL;
+    size_t num_pages = ROUND_UP_UNSAFE(size + SEL4OSAPI_HEAP_PAGE_HEADER_SIZE, PAGE_SIZE_4K) / PAGE_SIZE_4K;
+
+    page = (sel4osapi_heap_page_t *) vspace_new_pages(heap->vspace, seL4_AllRights, num_pages, PAGE_BITS_4K);
+    if (page == NULL)
+    {
+        return NULL;
+    }
+    page->magic = SEL4OSAPI_HEAP_PAGE_MAGIC;
+    page->num_pages = num_pages;
+
+    stats->pages += num_pages;
+    stats->blocks++;
+    stats->allocated_bytes += num_pages * PAGE_SIZE_4K;
+    return (char *) page + SEL4OSAPI_HEAP_PAGE_HEADER_SIZE;
+}
+
 void*
 sel4osapi_heap_allocate(size_t size)
 {
-    return malloc(size+64);
+    sel4osapi_heap_t *heap = &sel4osapi_gv_heap;
+    sel4osapi_heap_class_t *hclass = NULL;
+    int size_class = sel4osapi_heap_size_class(size);
+    void *ptr = NULL;
+    UNUSED int error = 0;
+
+    assert(heap->vspace != NULL);
+
+    error = sync_mutex_lock(&heap->mutex);
+    assert(error == 0);
+
+    hclass = &heap->classes[size_class];
+    if (size_class == SEL4OSAPI_HEAP_CLASS_LARGE)
+    {
+        ptr = sel4osapi_heap_allocate_large(heap, size);
+    }
+    else
+    {
+        if (hclass->free_blocks == NULL)
+        {
+            sel4osapi_heap_refill(heap, size_class);
+        }
+        ptr = hclass->free_blocks;
+        if (ptr != NULL)
+        {
+            hclass->free_blocks = *((void **) ptr);
+            hclass->stats.allocated_bytes += hclass->stats.block_size;
+        }
+    }
+
+    if (ptr != NULL)
+    {
+        hclass->stats.allocs++;
+        hclass->stats.requested_bytes += size;
+        hclass->stats.blocks_in_use++;
+        if (hclass->stats.blocks_in_use > hclass->stats.peak_blocks_in_use)
+        {
+            hclass->stats.peak_blocks_in_use = hclass->stats.blocks_in_use;
+        }
+    }
+    else
+    {
+        syslog_warn("failed to allocate %u bytes", (unsigned int) size);
+    }
+
+    sync_mutex_unlock(&heap->mutex);
+
+    return ptr;
 }
 
 void
 sel4osapi_heap_free(void* ptr)
 {
-    free(ptr);
+    sel4osapi_heap_t *heap = &sel4osapi_gv_heap;
+    sel4osapi_heap_page_t *page = NULL;
+    sel4osapi_heap_class_t *hclass = NULL;
+    int size_class = SEL4OSAPI_HEAP_CLASS_LARGE;
+    UNUSED int error = 0;
+
+    if (ptr == NULL)
+    {
+        return;
+    }
+
+    if (sel4osapi_heap_owns_page(heap, ptr))
+    {
+        size_class = heap->page_class[((char *) ptr - heap->pages_base) / PAGE_SIZE_4K];
+        assert(size_class < SEL4OSAPI_HEAP_CLASSES);
+    }
+    else
+    {
+        /* large allocations start right after their first page's header */
+        page = sel4osapi_heap_page_of((char *) ptr - SEL4OSAPI_HEAP_PAGE_HEADER_SIZE);
+        assert(page->magic == SEL4OSAPI_HEAP_PAGE_MAGIC);
+    }
+
+    error = sync_mutex_lock(&heap->mutex);
+    assert(error == 0);
+
+    hclass = &heap->classes[size_class];
+    hclass->stats.frees++;
+    hclass->stats.blocks_in_use--;
+
+    if (size_class == SEL4OSAPI_HEAP_CLASS_LARGE)
+    {
+        hclass->stats.pages -= page->num_pages;
+        hclass->stats.blocks--;
+        vspace_unmap_pages(heap->vspace, page, page->num_pages, PAGE_BITS_4K, VSPACE_FREE);
+    }
+    else
+    {
+        *((void **) ptr) = hclass->free_blocks;
+        hclass->free_blocks = ptr;
+    }
+
+    sync_mutex_unlock(&heap->mutex);
+}
+
+void
+sel4osapi_heap_get_stats(int size_class, sel4osapi_heap_class_stats_t *stats_out)
+{
+    sel4osapi_heap_t *heap = &sel4osapi_gv_heap;
+    UNUSED int error = 0;
+
+    assert(size_class >= 0 && size_class <= SEL4OSAPI_HEAP_CLASS_LARGE);
+    assert(stats_out != NULL);
+
+    error = sync_mutex_lock(&heap->mutex);
+    assert(error == 0);
+    *stats_out = heap->classes[size_class].stats;
+    sync_mutex_unlock(&heap->mutex);
+}
+
+void
+sel4osapi_heap_print_stats(void)
+{
+    sel4osapi_heap_class_stats_t stats;
+    int i = 0;
+
+    syslog_info("%6s %6s %8s %8s %8s %10s %10s %12s %12s",
+            "class", "pages", "blocks", "in_use", "peak", "allocs", "frees", "requested", "allocated");
+    for (i = 0; i <= SEL4OSAPI_HEAP_CLASSES; ++i) {
+        sel4osapi_heap_get_stats(i, &stats);
+        syslog_info("%6u %6u %8u %8u %8u %10lu %10lu %12llu %12llu",
+                (unsigned int) stats.block_size, stats.pages, stats.blocks,
+                stats.blocks_in_use, stats.peak_blocks_in_use,
+                stats.allocs, stats.frees,
+                stats.requested_bytes, stats.allocated_bytes);
+    }
 }
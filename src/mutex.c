@@ -0,0 +1,84 @@
+/*
+ * FILE: mutex.c - mutex implementation for sel4osapi
+ *
+ * Copyright (c) 2015, Real-Time Innovations, Inc. All rights reserved.
+ *
+ * This software may be distributed and modified according to the terms of
+ * the BSD 2-Clause license. Note that NO WARRANTY is provided.
+ * See "LICENSE_BSD2.txt" for details.
+ *
+ */
+
+#include <sel4osapi/osapi.h>
+
+sel4osapi_mutex_t*
+sel4osapi_mutex_create()
+{
+    sel4osapi_mutex_t *mutex = NULL;
+    UNUSED int error = 0;
+
+    mutex = (sel4osapi_mutex_t *) sel4osapi_heap_allocate(sizeof(sel4osapi_mutex_t));
+    assert(mutex != NULL);
+
+    error = sync_mutex_new(sel4osapi_system_get_vka(), &mutex->sem.lock);
+    assert(error == 0);
+    mutex->sem.count = 1;
+    mutex->sem.grants = 0;
+    sel4osapi_list_head_init(&mutex->sem.waiters);
+    mutex->owner = NULL;
+    mutex->held = 0;
+
+    return mutex;
+}
+
+void
+sel4osapi_mutex_delete(sel4osapi_mutex_t *mutex)
+{
+    assert(mutex != NULL);
+    assert(mutex->sem.waiters.count == 0);
+
+    sync_mutex_destroy(sel4osapi_system_get_vka(), &mutex->sem.lock);
+    sel4osapi_heap_free(mutex);
+}
+
+int
+sel4osapi_mutex_lock_timed(sel4osapi_mutex_t *mutex, int32_t timeout_ms)
+{
+    void *self = seL4_GetIPCBuffer();
+    int error = 0;
+
+    assert(mutex != NULL);
+
+    /* only the owner itself can observe the owner as itself */
+    if (__atomic_load_n(&mutex->owner, __ATOMIC_RELAXED) == self)
+    {
+        mutex->held++;
+        return 0;
+    }
+
+    error = sel4osapi_semaphore_take(&mutex->sem, timeout_ms);
+    if (error != 0)
+    {
+        return error;
+    }
+    __atomic_store_n(&mutex->owner, self, __ATOMIC_RELAXED);
+    mutex->held = 1;
+
+    return 0;
+}
+
+int
+sel4osapi_mutex_unlock(sel4osapi_mutex_t *mutex)
+{
+    assert(mutex != NULL);
+    assert(mutex->owner == seL4_GetIPCBuffer());
+    assert(mutex->held > 0);
+
+    if (--mutex->held > 0)
+    {
+        return 0;
+    }
+    __atomic_store_n(&mutex->owner, NULL, __ATOMIC_RELAXED);
+
+    return sel4osapi_semaphore_give(&mutex->sem);
+}
@@ -11,6 +11,64 @@
 
 #include <sel4osapi/osapi.h>
 
+static void
+simple_pool_init_fields(simple_pool_t *pool, int size, size_t el_size, simple_pool_init_el_fn init_fn, void *init_arg, simple_pool_compare_el_fn compare_fn)
+{
+    pool->el_size = el_size;
+    pool->size = size;
+    sel4osapi_list_head_init(&pool->free_entries);
+    sel4osapi_list_head_init(&pool->entries);
+    pool->init_fn = init_fn;
+    pool->init_arg = init_arg;
+    pool->compare_fn = compare_fn;
+    pool->current_size = 0;
+    pool->flags = 0;
+    pool->slab = NULL;
+    pool->slab_stride = 0;
+    pool->slab_el_offset = 0;
+    pool->free_head = SIMPLE_POOL_FREE_HEAD(0, 0);
+    pool->chunks = NULL;
+    pool->chunks_num = 0;
+    pool->chunk_size = 0;
+    pool->max_size = size;
+    pool->chunk_alloc = NULL;
+    pool->chunk_alloc_arg = NULL;
+    pool->growing = 0;
+}
+
+/*
+ * Bind an element to its list node and header.
+ */
+static void
+simple_pool_bind_el(simple_pool_t *pool, sel4osapi_list_t *node, void *el, uint32_t index)
+{
+    simple_pool_el_header_t *header = simple_pool_el_header(el);
+
+    node->el = el;
+    node->next = NULL;
+    node->prev = NULL;
+    header->pool = pool;
+    header->node = node;
+    header->allocated = 0;
+    header->next_free = 0;
+    header->index = index;
+
+    if (pool->init_fn)
+    {
+        pool->init_fn(el, pool->init_arg);
+    }
+}
+
+/*
+ * Bind an element to its list node and add it to the free entries.
+ */
+static void
+simple_pool_add_free_el(simple_pool_t *pool, sel4osapi_list_t *node, void *el, uint32_t index)
+{
+    simple_pool_bind_el(pool, node, el, index);
+    sel4osapi_list_head_append(&pool->free_entries, node);
+}
+
 simple_pool_t*
 simple_pool_new(int size, size_t el_size, simple_pool_init_el_fn init_fn, void *init_arg, simple_pool_compare_el_fn compare_fn)
 {
@@ -22,30 +80,391 @@ simple_pool_new(int size, size_t el_size, simple_pool_init_el_fn init_fn, void *
     pool = (simple_pool_t *) malloc(sizeof(simple_pool_t) + 64);
     assert(pool != NULL);
 
-    pool->el_size = el_size;
-    pool->size = size;
-    pool->free_entries = NULL;
-    pool->entries = NULL;
-    pool->init_fn = init_fn;
-    pool->init_arg = init_arg;
-    pool->compare_fn = compare_fn;
-    pool->current_size = 0;
+    simple_pool_init_fields(pool, size, el_size, init_fn, init_arg, compare_fn);
 
     int i = 0;
 
     for (i = 0; i < pool->size; ++i) {
-        void *el = malloc(pool->el_size + 64);
-        assert(el != NULL);
-        if (pool->init_fn)
+        sel4osapi_list_t *node = NULL;
+        char *block = malloc(SIMPLE_POOL_EL_HEADER_SIZE + pool->el_size + 64);
+        assert(block != NULL);
+        node = (sel4osapi_list_t *) malloc(sizeof(sel4osapi_list_t) + 64);
+        assert(node != NULL);
+
+        simple_pool_add_free_el(pool, node, block + SIMPLE_POOL_EL_HEADER_SIZE, i);
+    }
+
+    return pool;
+}
+
+static inline sel4osapi_list_t*
+simple_pool_slot_node(simple_pool_t *pool, uint32_t index)
+{
+    char *chunk = pool->chunks[index / pool->chunk_size];
+    return (sel4osapi_list_t *) (chunk + (size_t) (index % pool->chunk_size) * pool->slab_stride);
+}
+
+/*
+ * Push a chain of slots, already linked through their next_free
+ * indices, on the free stack of a lock-free pool.
+ */
+static void
+simple_pool_lockfree_push_chain(simple_pool_t *pool, sel4osapi_list_t *first, sel4osapi_list_t *last)
+{
+    simple_pool_el_header_t *last_header = simple_pool_el_header(last->el);
+    uint32_t index = simple_pool_el_header(first->el)->index;
+    uint64_t head, new_head;
+
+    head = __atomic_load_n(&pool->free_head, __ATOMIC_RELAXED);
+    do {
+        __atomic_store_n(&last_header->next_free, SIMPLE_POOL_FREE_HEAD_INDEX(head), __ATOMIC_RELAXED);
+        new_head = SIMPLE_POOL_FREE_HEAD(SIMPLE_POOL_FREE_HEAD_TAG(head) + 1, index + 1);
+    } while (!__atomic_compare_exchange_n(&pool->free_head, &head, new_head, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+/*
+ * Push a slot back on the free stack of a lock-free pool.
+ */
+static inline void
+simple_pool_lockfree_push(simple_pool_t *pool, sel4osapi_list_t *entry)
+{
+    simple_pool_lockfree_push_chain(pool, entry, entry);
+}
+
+/*
+ * Bind 'count' slots of a chunk, starting at slot index 'first',
+ * and hand them over to the pool's free list.
+ */
+static void
+simple_pool_init_chunk(simple_pool_t *pool, char *chunk, uint32_t first, int count)
+{
+    int i = 0;
+
+    for (i = 0; i < count; ++i) {
+        char *slot = chunk + (size_t) i * pool->slab_stride;
+        void *el = slot + pool->slab_el_offset;
+
+        if (pool->flags & SIMPLE_POOL_FLAG_LOCKFREE)
+        {
+            /* slot i is followed by slot i+1 on the free stack */
+            simple_pool_bind_el(pool, (sel4osapi_list_t *) slot, el, first + i);
+            simple_pool_el_header(el)->next_free = first + i + 2;
+        }
+        else
         {
-            pool->init_fn(el, pool->init_arg);
+            simple_pool_add_free_el(pool, (sel4osapi_list_t *) slot, el, first + i);
         }
-        pool->free_entries = sel4osapi_list_insert(pool->free_entries, el);
     }
 
+    if (pool->flags & SIMPLE_POOL_FLAG_LOCKFREE)
+    {
+        simple_pool_lockfree_push_chain(pool,
+                (sel4osapi_list_t *) chunk,
+                (sel4osapi_list_t *) (chunk + (size_t) (count - 1) * pool->slab_stride));
+    }
+}
+
+static simple_pool_t*
+simple_pool_new_slab_flags(int size, size_t el_size, simple_pool_init_el_fn init_fn, void *init_arg, simple_pool_compare_el_fn compare_fn, unsigned int flags)
+{
+    simple_pool_t *pool = NULL;
+    size_t pool_size, node_size, stride;
+    char *block = NULL;
+
+    assert(size > 0);
+    assert(el_size > 0);
+
+    /*
+     * Slot layout: [list node][element header][element],
+     * padded to a multiple of the cache line size.
+     */
+    pool_size = ROUND_UP_UNSAFE(sizeof(simple_pool_t), SIMPLE_POOL_CACHE_LINE_SIZE);
+    node_size = ROUND_UP_UNSAFE(sizeof(sel4osapi_list_t), 2 * sizeof(seL4_Word));
+    stride = ROUND_UP_UNSAFE(node_size + SIMPLE_POOL_EL_HEADER_SIZE + el_size, SIMPLE_POOL_CACHE_LINE_SIZE);
+
+    /* one extra cache line to align the start of the block */
+    block = malloc(SIMPLE_POOL_CACHE_LINE_SIZE + pool_size + (size_t) size * stride);
+    assert(block != NULL);
+    block = (char *) ROUND_UP_UNSAFE((seL4_Word) block, SIMPLE_POOL_CACHE_LINE_SIZE);
+
+    pool = (simple_pool_t *) block;
+    simple_pool_init_fields(pool, size, el_size, init_fn, init_arg, compare_fn);
+    pool->flags = SIMPLE_POOL_FLAG_SLAB | flags;
+    pool->slab = block + pool_size;
+    pool->slab_stride = stride;
+    pool->slab_el_offset = node_size + SIMPLE_POOL_EL_HEADER_SIZE;
+    pool->chunks = &pool->slab;
+    pool->chunks_num = 1;
+    pool->chunk_size = size;
+
+    simple_pool_init_chunk(pool, pool->slab, 0, size);
+
     return pool;
 }
 
+simple_pool_t*
+simple_pool_new_slab(int size, size_t el_size, simple_pool_init_el_fn init_fn, void *init_arg, simple_pool_compare_el_fn compare_fn)
+{
+    return simple_pool_new_slab_flags(size, el_size, init_fn, init_arg, compare_fn, 0);
+}
+
+simple_pool_t*
+simple_pool_new_lockfree(int size, size_t el_size, simple_pool_init_el_fn init_fn, void *init_arg)
+{
+    return simple_pool_new_slab_flags(size, el_size, init_fn, init_arg, NULL, SIMPLE_POOL_FLAG_LOCKFREE);
+}
+
+void
+simple_pool_set_growth(simple_pool_t *pool, int max_size, simple_pool_chunk_alloc_fn chunk_alloc, void *chunk_alloc_arg)
+{
+    int max_chunks = 0;
+
+    assert(pool != NULL);
+    assert(pool->flags & SIMPLE_POOL_FLAG_SLAB);
+    assert(pool->chunks_num == 1);
+    assert(max_size >= pool->size);
+
+    max_chunks = (max_size + pool->chunk_size - 1) / pool->chunk_size;
+    pool->chunks = (char **) malloc(max_chunks * sizeof(char *));
+    assert(pool->chunks != NULL);
+    pool->chunks[0] = pool->slab;
+
+    pool->max_size = max_size;
+    pool->chunk_alloc = chunk_alloc;
+    pool->chunk_alloc_arg = chunk_alloc_arg;
+}
+
+void*
+simple_pool_vspace_chunk_alloc(size_t bytes, void *arg)
+{
+    vspace_t *vspace = (arg != NULL) ? (vspace_t *) arg : sel4osapi_system_get_vspace();
+
+    return vspace_new_pages(vspace, seL4_AllRights,
+            ROUND_UP_UNSAFE(bytes, PAGE_SIZE_4K) / PAGE_SIZE_4K, PAGE_BITS_4K);
+}
+
+/*
+ * Add a new chunk of elements to a growable pool.
+ * Returns 0 on success, -1 if the pool cannot grow (right now).
+ */
+static int
+simple_pool_grow(simple_pool_t *pool)
+{
+    int lockfree = pool->flags & SIMPLE_POOL_FLAG_LOCKFREE;
+    int size, count;
+    size_t bytes;
+    char *chunk = NULL;
+
+    if (__atomic_load_n(&pool->size, __ATOMIC_ACQUIRE) >= pool->max_size)
+    {
+        return -1;
+    }
+    /* never wait for another thread to finish growing the pool */
+    if (lockfree && __atomic_exchange_n(&pool->growing, 1, __ATOMIC_ACQUIRE))
+    {
+        return -1;
+    }
+
+    size = pool->size;
+    count = pool->max_size - size;
+    if (count > pool->chunk_size)
+    {
+        count = pool->chunk_size;
+    }
+    if (count <= 0)
+    {
+        goto done;
+    }
+
+    /* one extra cache line to align the start of the chunk */
+    bytes = SIMPLE_POOL_CACHE_LINE_SIZE + (size_t) count * pool->slab_stride;
+    chunk = (pool->chunk_alloc != NULL) ? pool->chunk_alloc(bytes, pool->chunk_alloc_arg) : malloc(bytes);
+    if (chunk == NULL)
+    {
+        syslog_warn("failed to grow pool %p beyond %d elements", pool, size);
+        goto done;
+    }
+    chunk = (char *) ROUND_UP_UNSAFE((seL4_Word) chunk, SIMPLE_POOL_CACHE_LINE_SIZE);
+
+    /* publish the chunk before any of its slots becomes reachable */
+    pool->chunks[pool->chunks_num] = chunk;
+    __atomic_store_n(&pool->chunks_num, pool->chunks_num + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&pool->size, size + count, __ATOMIC_RELEASE);
+
+    simple_pool_init_chunk(pool, chunk, size, count);
+
+done:
+    if (lockfree)
+    {
+        __atomic_store_n(&pool->growing, 0, __ATOMIC_RELEASE);
+    }
+    return (chunk != NULL) ? 0 : -1;
+}
+
+/*
+ * Pop a slot from the free stack of a lock-free pool.
+ */
+static sel4osapi_list_t*
+simple_pool_lockfree_pop(simple_pool_t *pool)
+{
+    uint64_t head, new_head;
+    uint32_t index;
+    sel4osapi_list_t *entry;
+
+    head = __atomic_load_n(&pool->free_head, __ATOMIC_ACQUIRE);
+    do {
+        index = SIMPLE_POOL_FREE_HEAD_INDEX(head);
+        if (index == 0)
+        {
+            return NULL;
+        }
+        entry = simple_pool_slot_node(pool, index - 1);
+        /* next_free may be stale if another thread popped this slot
+         * meanwhile, in which case the tag makes the CAS fail */
+        new_head = SIMPLE_POOL_FREE_HEAD(SIMPLE_POOL_FREE_HEAD_TAG(head) + 1,
+                __atomic_load_n(&simple_pool_el_header(entry->el)->next_free, __ATOMIC_RELAXED));
+    } while (!__atomic_compare_exchange_n(&pool->free_head, &head, new_head, 1, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+    return entry;
+}
+
+/*
+ * Pop a slot from a lock-free pool, growing the pool if it is empty.
+ */
+static sel4osapi_list_t*
+simple_pool_lockfree_get(simple_pool_t *pool)
+{
+    sel4osapi_list_t *entry = simple_pool_lockfree_pop(pool);
+
+    if (entry == NULL && simple_pool_grow(pool) == 0)
+    {
+        entry = simple_pool_lockfree_pop(pool);
+    }
+    return entry;
+}
+
+void
+simple_pool_enable_magazines(simple_pool_t *pool)
+{
+    assert(pool != NULL);
+    /* the shared free list must be safe to refill from any thread */
+    assert(pool->flags & SIMPLE_POOL_FLAG_LOCKFREE);
+
+    pool->flags |= SIMPLE_POOL_FLAG_MAGAZINES;
+}
+
+/*
+ * Find (or bind) the calling thread's magazine for a pool.
+ * Returns NULL if the thread has no magazine left.
+ */
+static simple_pool_magazine_t*
+simple_pool_get_magazine(simple_pool_t *pool)
+{
+    sel4osapi_thread_info_t *thread = sel4osapi_thread_get_current();
+    simple_pool_thread_cache_t *cache = NULL;
+    simple_pool_magazine_t *unused = NULL;
+    int i = 0;
+
+    if (thread == NULL)
+    {
+        return NULL;
+    }
+
+    cache = (simple_pool_thread_cache_t *) thread->pool_cache;
+    if (cache == NULL)
+    {
+        cache = (simple_pool_thread_cache_t *) malloc(sizeof(simple_pool_thread_cache_t));
+        assert(cache != NULL);
+        for (i = 0; i < SIMPLE_POOL_MAGAZINES_PER_THREAD; ++i) {
+            cache->magazines[i].pool = NULL;
+            cache->magazines[i].count = 0;
+        }
+        thread->pool_cache = cache;
+    }
+
+    for (i = 0; i < SIMPLE_POOL_MAGAZINES_PER_THREAD; ++i) {
+        if (cache->magazines[i].pool == pool)
+        {
+            return &cache->magazines[i];
+        }
+        if (cache->magazines[i].pool == NULL && unused == NULL)
+        {
+            unused = &cache->magazines[i];
+        }
+    }
+
+    if (unused != NULL)
+    {
+        unused->pool = pool;
+        unused->count = 0;
+    }
+    return unused;
+}
+
+/*
+ * Move up to 'count' free slots from the shared free list into a magazine.
+ */
+static void
+simple_pool_magazine_refill(simple_pool_magazine_t *magazine, int count)
+{
+    simple_pool_t *pool = magazine->pool;
+    int moved = 0;
+
+    while (moved < count && magazine->count < SIMPLE_POOL_MAGAZINE_SIZE)
+    {
+        sel4osapi_list_t *entry = simple_pool_lockfree_get(pool);
+        if (entry == NULL)
+        {
+            break;
+        }
+        magazine->rounds[magazine->count++] = entry;
+        moved++;
+    }
+    __atomic_add_fetch(&pool->current_size, moved, __ATOMIC_RELAXED);
+}
+
+/*
+ * Move up to 'count' free slots from a magazine back to the shared free list.
+ */
+static void
+simple_pool_magazine_drain(simple_pool_magazine_t *magazine, int count)
+{
+    simple_pool_t *pool = magazine->pool;
+    int moved = 0;
+
+    while (moved < count && magazine->count > 0)
+    {
+        simple_pool_lockfree_push(pool, magazine->rounds[--magazine->count]);
+        moved++;
+    }
+    __atomic_sub_fetch(&pool->current_size, moved, __ATOMIC_RELAXED);
+}
+
+void
+simple_pool_flush_thread_cache(void)
+{
+    sel4osapi_thread_info_t *thread = sel4osapi_thread_get_current();
+    simple_pool_thread_cache_t *cache = NULL;
+    int i = 0;
+
+    if (thread == NULL || thread->pool_cache == NULL)
+    {
+        return;
+    }
+
+    cache = (simple_pool_thread_cache_t *) thread->pool_cache;
+    for (i = 0; i < SIMPLE_POOL_MAGAZINES_PER_THREAD; ++i) {
+        if (cache->magazines[i].pool != NULL)
+        {
+            simple_pool_magazine_drain(&cache->magazines[i], SIMPLE_POOL_MAGAZINE_SIZE);
+            cache->magazines[i].pool = NULL;
+        }
+    }
+
+    /* the thread's slot may be reused, which starts without a cache */
+    thread->pool_cache = NULL;
+    free(cache);
+}
 
 void*
 simple_pool_alloc(simple_pool_t *pool)
@@ -65,7 +484,51 @@ simple_pool_alloc_entry(simple_pool_t *pool)
 
     assert(pool != NULL);
 
-    entry = pool->free_entries;
+    if (pool->flags & SIMPLE_POOL_FLAG_LOCKFREE)
+    {
+        simple_pool_magazine_t *magazine = NULL;
+
+        if (pool->flags & SIMPLE_POOL_FLAG_MAGAZINES)
+        {
+            magazine = simple_pool_get_magazine(pool);
+        }
+
+        if (magazine != NULL)
+        {
+            if (magazine->count == 0)
+            {
+                simple_pool_magazine_refill(magazine, SIMPLE_POOL_MAGAZINE_SIZE / 2);
+            }
+            if (magazine->count == 0)
+            {
+                return NULL;
+            }
+            entry = magazine->rounds[--magazine->count];
+        }
+        else
+        {
+            entry = simple_pool_lockfree_get(pool);
+            if (entry == NULL)
+            {
+                return NULL;
+            }
+            __atomic_add_fetch(&pool->current_size, 1, __ATOMIC_RELAXED);
+        }
+
+        if (pool->init_fn)
+        {
+            pool->init_fn(entry->el, pool->init_arg);
+        }
+        __atomic_store_n(&simple_pool_el_header(entry->el)->allocated, 1, __ATOMIC_RELAXED);
+        return entry;
+    }
+
+    if (pool->free_entries.head == NULL && pool->size < pool->max_size)
+    {
+        simple_pool_grow(pool);
+    }
+
+    entry = pool->free_entries.head;
 
     if (entry == NULL)
     {
@@ -76,14 +539,15 @@ simple_pool_alloc_entry(simple_pool_t *pool)
 
     assert(entry->el != NULL);
 
-    pool->free_entries = sel4osapi_list_unlink(pool->free_entries, entry);
+    sel4osapi_list_head_unlink(&pool->free_entries, entry);
 
     if (pool->init_fn)
     {
         pool->init_fn(entry->el, pool->init_arg);
     }
 
-    pool->entries = sel4osapi_list_insert_node(pool->entries, entry);
+    simple_pool_el_header(entry->el)->allocated = 1;
+    sel4osapi_list_head_append(&pool->entries, entry);
     pool->current_size++;
 
     assert(pool->current_size <= pool->size);
@@ -94,16 +558,26 @@ simple_pool_alloc_entry(simple_pool_t *pool)
 int
 simple_pool_free(simple_pool_t *pool, void *el)
 {
-    sel4osapi_list_t *entry = NULL;
+    simple_pool_el_header_t *header = NULL;
     assert(pool != NULL);
     assert(el != NULL);
 
-    entry = simple_pool_find_node(pool, el);
-    if (entry == NULL)
+    /* the element's header points straight at its node,
+     * so there is no need to search the pool's entries */
+    header = simple_pool_el_header(el);
+    if (header->pool != pool || header->node->el != el)
+    {
+        return -1;
+    }
+    if (pool->flags & SIMPLE_POOL_FLAG_LOCKFREE)
+    {
+        return simple_pool_free_entry(pool, header->node);
+    }
+    if (!header->allocated)
     {
         return -1;
     }
-    return simple_pool_free_entry(pool, entry);
+    return simple_pool_free_entry(pool, header->node);
 }
 
 int
@@ -114,7 +588,46 @@ simple_pool_free_entry(simple_pool_t *pool, sel4osapi_list_t *entry)
 
     /*printf("### [POOL=%x][FREE][ENTRY=%x][SIZE=%d] &&&\n", (unsigned int) pool, (unsigned int) entry, pool->current_size);*/
 
-    pool->entries = sel4osapi_list_unlink(pool->entries, entry);
+    if (pool->flags & SIMPLE_POOL_FLAG_LOCKFREE)
+    {
+        simple_pool_magazine_t *magazine = NULL;
+
+        /* only one of two racing frees of the same element may succeed */
+        if (!__atomic_exchange_n(&simple_pool_el_header(entry->el)->allocated, 0, __ATOMIC_ACQ_REL))
+        {
+            return -1;
+        }
+
+        if (pool->init_fn)
+        {
+            pool->init_fn(entry->el, pool->init_arg);
+        }
+
+        if (pool->flags & SIMPLE_POOL_FLAG_MAGAZINES)
+        {
+            magazine = simple_pool_get_magazine(pool);
+        }
+
+        if (magazine != NULL)
+        {
+            if (magazine->count == SIMPLE_POOL_MAGAZINE_SIZE)
+            {
+                simple_pool_magazine_drain(magazine, SIMPLE_POOL_MAGAZINE_SIZE / 2);
+            }
+            magazine->rounds[magazine->count++] = entry;
+        }
+        else
+        {
+            __atomic_sub_fetch(&pool->current_size, 1, __ATOMIC_RELAXED);
+            simple_pool_lockfree_push(pool, entry);
+        }
+        return 0;
+    }
+
+    assert(simple_pool_el_header(entry->el)->allocated);
+    simple_pool_el_header(entry->el)->allocated = 0;
+
+    sel4osapi_list_head_unlink(&pool->entries, entry);
     pool->current_size--;
 
     assert(pool->current_size >= 0);
@@ -124,7 +637,7 @@ simple_pool_free_entry(simple_pool_t *pool, sel4osapi_list_t *entry)
         pool->init_fn(entry->el, pool->init_arg);
     }
 
-    pool->free_entries = sel4osapi_list_insert_node(pool->free_entries, entry);
+    sel4osapi_list_head_append(&pool->free_entries, entry);
 
     return 0;
 }
@@ -133,7 +646,7 @@ simple_pool_free_entry(simple_pool_t *pool, sel4osapi_list_t *entry)
 sel4osapi_list_t*
 simple_pool_find_node(simple_pool_t *pool, void *el)
 {
-    sel4osapi_list_t *cursor = pool->entries;
+    sel4osapi_list_t *cursor = pool->entries.head;
     sel4osapi_list_t *entry = NULL;
 
     while (cursor != NULL && entry == NULL)
@@ -162,6 +675,69 @@ simple_pool_find_node(simple_pool_t *pool, void *el)
 int
 simple_pool_get_current_size(simple_pool_t *pool)
 {
-    return pool->current_size;
+    return __atomic_load_n(&pool->current_size, __ATOMIC_RELAXED);
+}
+
+#ifdef CONFIG_LIB_OSAPI_POOL_BENCHMARK
+/*
+ * Size of the elements of the benchmark's pools.
+ */
+#define SIMPLE_POOL_BENCHMARK_EL_SIZE   32
+
+static uint64_t
+simple_pool_benchmark_now(void)
+{
+    if (SEL4OSAPI_SYSCLOCK_HAS_CYCLES)
+    {
+        return sel4osapi_sysclock_get_cycles();
+    }
+    return sel4osapi_sysclock_get_time_ns();
 }
 
+void
+simple_pool_benchmark(int iterations)
+{
+    static const int sizes[] = { 16, 64, 256, 1024 };
+    const char *unit = SEL4OSAPI_SYSCLOCK_HAS_CYCLES ? "cycles" : "ns";
+    int s = 0, i = 0;
+
+    assert(iterations > 0);
+
+    for (s = 0; s < (int) ARRAY_SIZE(sizes); ++s) {
+        simple_pool_t *pool = NULL;
+        void **els = NULL;
+        int live = sizes[s] / 2;
+        uint64_t start, elapsed;
+        UNUSED int error = 0;
+
+        pool = simple_pool_new(sizes[s], SIMPLE_POOL_BENCHMARK_EL_SIZE, NULL, NULL, NULL);
+        assert(pool != NULL);
+        els = (void **) malloc(live * sizeof(void *));
+        assert(els != NULL);
+
+        for (i = 0; i < live; ++i) {
+            els[i] = simple_pool_alloc(pool);
+            assert(els[i] != NULL);
+        }
+
+        /* free the live elements in turn, so that each position
+         * in the list of allocated elements is exercised */
+        start = simple_pool_benchmark_now();
+        for (i = 0; i < iterations; ++i) {
+            error = simple_pool_free(pool, els[i % live]);
+            assert(error == 0);
+            els[i % live] = simple_pool_alloc(pool);
+            assert(els[i % live] != NULL);
+        }
+        elapsed = simple_pool_benchmark_now() - start;
+
+        sel4osapi_printf("pool benchmark: size=%4d, %llu %s per free+alloc\n",
+                sizes[s], (unsigned long long) (elapsed / iterations), unit);
+
+        for (i = 0; i < live; ++i) {
+            simple_pool_free(pool, els[i]);
+        }
+        free(els);
+    }
+}
+#endif
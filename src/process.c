@@ -26,6 +26,8 @@ sel4osapi_process_init_env(sel4osapi_process_t *process,
                             uint8_t *user_untypeds_size_bits,
                             vka_object_t *user_untypeds,
                             seL4_CPtr sysclock_ep,
+                            seL4_CPtr sysclock_time_ep,
+                            void *sysclock_time_page,
                             seL4_CPtr udp_stack_ep)
 {
     int error;
@@ -72,9 +74,32 @@ sel4osapi_process_init_env(sel4osapi_process_t *process,
         assert((process->env->untypeds.end - process->env->untypeds.start) + 1 <= user_untypeds_num);
 #ifdef CONFIG_LIB_OSAPI_SYSCLOCK
         {
-            /* copy the sysclock's EP */
+            /* copy the sysclock's EPs, badged with the pid, which
+             * identifies the process to the sysclock server */
             process->env->sysclock_server_ep = sel4osapi_process_copy_cap_into(process, parent_vka, sysclock_ep, seL4_AllRights);
             assert(process->env->sysclock_server_ep != 0);
+            process->env->sysclock_time_ep = sel4osapi_process_copy_cap_into(process, parent_vka, sysclock_time_ep, seL4_AllRights);
+            assert(process->env->sysclock_time_ep != 0);
+        }
+        process->env->sysclock_time_page = NULL;
+        if (sysclock_time_page != NULL)
+        {
+            /* map the sysclock's time page, read-only */
+            seL4_CPtr time_page;
+            seL4_CPtr time_page_mint;
+            cspacepath_t dest, src;
+
+            time_page = vspace_get_cap(parent_vspace, sysclock_time_page);
+            assert(time_page != seL4_CapNull);
+            vka_cspace_make_path(parent_vka, time_page, &src);
+            error = vka_cspace_alloc(parent_vka, &time_page_mint);
+            assert(error == 0);
+            vka_cspace_make_path(parent_vka, time_page_mint, &dest);
+            error = vka_cnode_copy(&dest, &src, seL4_CanRead);
+            assert(error == 0);
+
+            process->env->sysclock_time_page = vspace_map_pages(&process->native.vspace, &time_page_mint, NULL, seL4_CanRead, 1, PAGE_BITS_4K, 1);
+            assert(process->env->sysclock_time_page != NULL);
         }
 #endif
         {
@@ -138,31 +163,58 @@ sel4osapi_process_init_env(sel4osapi_process_t *process,
 #endif
 #ifdef CONFIG_LIB_OSAPI_SERIAL
         {
-            /* register process with network driver */
-            seL4_CPtr buf_pages[SEL4OSAPI_SERIAL_BUF_PAGES];
-            seL4_CPtr buf_pages_mint[SEL4OSAPI_SERIAL_BUF_PAGES];
+            /* register process with the serial ports */
+            seL4_CPtr buf_pages[SEL4OSAPI_SERIAL_SHM_PAGES];
+            seL4_CPtr buf_pages_mint[SEL4OSAPI_SERIAL_SHM_PAGES];
             cspacepath_t dest, src;
+            int j = 0;
 
             process->env->serial.id = process->serialclient->id;
 
-            process->env->serial.server_ep = sel4osapi_process_copy_cap_into(process, parent_vka, process->serialclient->server_ep, seL4_AllRights);
-            assert(process->env->serial.server_ep != seL4_CapNull);
-
-            for (i = 0; i < SEL4OSAPI_SERIAL_BUF_PAGES; ++i) {
-                buf_pages[i] = vspace_get_cap(parent_vspace, process->serialclient->buf + i * PAGE_SIZE_4K);
-                assert(buf_pages[i] != seL4_CapNull);
-                vka_cspace_make_path(parent_vka, buf_pages[i], &src);
-                error = vka_cspace_alloc(parent_vka, &buf_pages_mint[i]);
-                assert(error == 0);
-                vka_cspace_make_path(parent_vka, buf_pages_mint[i], &dest);
-                error = vka_cnode_copy(&dest, &src, seL4_AllRights);
-                assert(error == 0);
+            for (j = 0; j < SEL4OSAPI_SERIAL_PORTS; ++j) {
+                sel4osapi_serialclient_port_t *client_port = &process->serialclient->ports[j];
+                sel4osapi_serialclient_port_t *env_port = &process->env->serial.ports[j];
+
+                memset(env_port, 0, sizeof(sel4osapi_serialclient_port_t));
+                if (client_port->server_ep == seL4_CapNull)
+                {
+                    /* port not enabled */
+                    continue;
+                }
+
+                env_port->server_ep = sel4osapi_process_copy_cap_into(process, parent_vka, client_port->server_ep, seL4_AllRights);
+                assert(env_port->server_ep != seL4_CapNull);
+
+                env_port->server_aep = sel4osapi_process_copy_cap_into(process, parent_vka, client_port->server_aep, seL4_AllRights);
+                assert(env_port->server_aep != seL4_CapNull);
+
+                env_port->client_aep = sel4osapi_process_copy_cap_into(process, parent_vka, client_port->client_aep, seL4_AllRights);
+                assert(env_port->client_aep != seL4_CapNull);
+
+                env_port->read_aep = sel4osapi_process_copy_cap_into(process, parent_vka, client_port->read_aep, seL4_AllRights);
+                assert(env_port->read_aep != seL4_CapNull);
+
+                env_port->flush_aep = sel4osapi_process_copy_cap_into(process, parent_vka, client_port->flush_aep, seL4_AllRights);
+                assert(env_port->flush_aep != seL4_CapNull);
+
+                /* the buffer and the ring */
+                for (i = 0; i < SEL4OSAPI_SERIAL_SHM_PAGES; ++i) {
+                    buf_pages[i] = vspace_get_cap(parent_vspace, client_port->buf + i * PAGE_SIZE_4K);
+                    assert(buf_pages[i] != seL4_CapNull);
+                    vka_cspace_make_path(parent_vka, buf_pages[i], &src);
+                    error = vka_cspace_alloc(parent_vka, &buf_pages_mint[i]);
+                    assert(error == 0);
+                    vka_cspace_make_path(parent_vka, buf_pages_mint[i], &dest);
+                    error = vka_cnode_copy(&dest, &src, seL4_AllRights);
+                    assert(error == 0);
+                }
+
+                env_port->buf = vspace_map_pages(&process->native.vspace, buf_pages_mint, NULL, seL4_AllRights, SEL4OSAPI_SERIAL_SHM_PAGES, PAGE_BITS_4K, 1);
+                assert(env_port->buf != NULL);
+                env_port->buf_size = SEL4OSAPI_SERIAL_BUF_SIZE;
+                env_port->ring = (sel4osapi_serial_ring_t *) ((char *) env_port->buf + SEL4OSAPI_SERIAL_BUF_SIZE);
             }
 
-            process->env->serial.buf = vspace_map_pages(&process->native.vspace, buf_pages_mint, NULL, seL4_AllRights, SEL4OSAPI_SERIAL_BUF_PAGES, PAGE_BITS_4K, 1);
-            assert(process->env->serial.buf != NULL);
-            process->env->serial.buf_size = SEL4OSAPI_SERIAL_BUF_SIZE;
-
         }
 #endif
         /* copy the fault endpoint - we wait on the endpoint for a message
@@ -216,7 +268,7 @@ sel4osapi_process_create(char *process_name, uint8_t priority)
     assert(process->serialclient != NULL);
 #endif
 
-    process->ipcclient = sel4osapi_ipc_create_client(&system->ipc, pid);
+    process->ipcclient = sel4osapi_ipc_create_client(&system->ipc);
     assert(process->ipcclient != NULL);
 
     error = sel4osapi_process_init_env(process,
@@ -227,9 +279,13 @@ sel4osapi_process_create(char *process_name, uint8_t priority)
             system->user_untypeds_size_bits,
             system->user_untypeds,
 #ifdef CONFIG_LIB_OSAPI_SYSCLOCK
-            system->sysclock.server_ep_obj.cptr
+            system->sysclock.server_ep_obj.cptr,
+            system->sysclock.time_ep_obj.cptr,
+            system->sysclock.time_page
 #else
-            seL4_CapNull
+            seL4_CapNull,
+            seL4_CapNull,
+            NULL
 #endif
             ,
 #ifdef CONFIG_LIB_OSAPI_NET
@@ -308,6 +364,8 @@ sel4osapi_process_fork(char *process_name, uint8_t priority, void *entry_point)
             system->user_untypeds_size_bits,
             system->user_untypeds,
             system->sysclock.server_ep_obj.cptr,
+            system->sysclock.time_ep_obj.cptr,
+            system->sysclock.time_page,
             system->udp.stack_op_ep);
     assert(!error);
 
@@ -0,0 +1,220 @@
+/*
+ * FILE: semaphore.c - semaphore implementation for sel4osapi
+ *
+ * Copyright (c) 2015, Real-Time Innovations, Inc. All rights reserved.
+ *
+ * This software may be distributed and modified according to the terms of
+ * the BSD 2-Clause license. Note that NO WARRANTY is provided.
+ * See "LICENSE_BSD2.txt" for details.
+ *
+ */
+
+#include <sel4osapi/osapi.h>
+
+/*
+ * A thread waiting on a semaphore. Lives on the waiting thread's stack.
+ */
+typedef struct sel4osapi_semaphore_waiter
+{
+    seL4_CPtr aep;
+    /*
+     * Set by the giving thread, with the semaphore's lock held.
+     */
+    int granted;
+    sel4osapi_list_t node;
+} sel4osapi_semaphore_waiter_t;
+
+sel4osapi_semaphore_t*
+sel4osapi_semaphore_create(int init)
+{
+    sel4osapi_semaphore_t *sem = NULL;
+    UNUSED int error = 0;
+
+    sem = (sel4osapi_semaphore_t *) sel4osapi_heap_allocate(sizeof(sel4osapi_semaphore_t));
+    assert(sem != NULL);
+
+    error = sync_mutex_new(sel4osapi_system_get_vka(), &sem->lock);
+    assert(error == 0);
+    sem->count = init;
+    sem->grants = 0;
+    sel4osapi_list_head_init(&sem->waiters);
+
+    return sem;
+}
+
+void
+sel4osapi_semaphore_delete(sel4osapi_semaphore_t* sem)
+{
+    assert(sem != NULL);
+    assert(sem->waiters.count == 0);
+
+    sync_mutex_destroy(sel4osapi_system_get_vka(), &sem->lock);
+    sel4osapi_heap_free(sem);
+}
+
+/*
+ * Decrement the count if it is positive, without entering the kernel.
+ */
+static int
+sel4osapi_semaphore_try_take(sel4osapi_semaphore_t* sem)
+{
+    int count = __atomic_load_n(&sem->count, __ATOMIC_RELAXED);
+
+    while (count > 0)
+    {
+        if (__atomic_compare_exchange_n(&sem->count, &count, count - 1, 0,
+                __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Withdraw a waiter whose timeout expired, by giving back the unit it
+ * subtracted from the count. This is only possible while the count is
+ * negative: otherwise every waiter, including this one, has already been
+ * matched by a give, which will hand it the semaphore shortly.
+ */
+static int
+sel4osapi_semaphore_withdraw(sel4osapi_semaphore_t* sem)
+{
+    int count = __atomic_load_n(&sem->count, __ATOMIC_RELAXED);
+
+    while (count < 0)
+    {
+        if (__atomic_compare_exchange_n(&sem->count, &count, count + 1, 0,
+                __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int
+sel4osapi_semaphore_take(sel4osapi_semaphore_t* sem, int32_t timeout_ms)
+{
+    sel4osapi_semaphore_waiter_t waiter;
+    seL4_Word timeout_id = 0;
+    UNUSED uint32_t deadline = 0;
+    int result = 0;
+    seL4_Word badge;
+
+    assert(sem != NULL);
+
+    if (sel4osapi_semaphore_try_take(sem))
+    {
+        return 0;
+    }
+    if (timeout_ms == 0)
+    {
+        return SEL4OSAPI_WAIT_TIMEOUT;
+    }
+    if (__atomic_fetch_sub(&sem->count, 1, __ATOMIC_SEQ_CST) > 0)
+    {
+        return 0;
+    }
+
+    /* the count is now negative: wait for a give to hand us a unit */
+    sync_mutex_lock(&sem->lock);
+    if (sem->grants > 0)
+    {
+        /* given before we could queue up */
+        sem->grants--;
+        sync_mutex_unlock(&sem->lock);
+        return 0;
+    }
+    waiter.aep = sel4osapi_thread_get_current()->sem_aep;
+    waiter.granted = 0;
+    waiter.node.el = &waiter;
+    sel4osapi_list_head_append(&sem->waiters, &waiter.node);
+    sync_mutex_unlock(&sem->lock);
+
+    if (timeout_ms > 0)
+    {
+#ifdef CONFIG_LIB_OSAPI_SYSCLOCK
+        deadline = sel4osapi_sysclock_get_time() + timeout_ms;
+        timeout_id = sel4osapi_sysclock_schedule_timeout_at(0, deadline, 0, waiter.aep);
+        assert(timeout_id != 0);
+#else
+        syslog_warn("SYSCLOCK not enabled, waiting on semaphore without timeout!");
+#endif
+    }
+
+    while (1)
+    {
+        seL4_Wait(waiter.aep, &badge);
+
+        sync_mutex_lock(&sem->lock);
+        if (waiter.granted)
+        {
+            result = 0;
+            break;
+        }
+#ifdef CONFIG_LIB_OSAPI_SYSCLOCK
+        if (timeout_id != 0 && ((int32_t) (sel4osapi_sysclock_get_time() - deadline)) >= 0
+                && sel4osapi_semaphore_withdraw(sem))
+        {
+            sel4osapi_list_head_unlink(&sem->waiters, &waiter.node);
+            result = SEL4OSAPI_WAIT_TIMEOUT;
+            break;
+        }
+#endif
+        /* a stale signal from an earlier semaphore wait (a give
+         * or a timeout which raced with the end of that wait),
+         * or a timeout which lost the race with a give */
+        sync_mutex_unlock(&sem->lock);
+    }
+    sync_mutex_unlock(&sem->lock);
+
+#ifdef CONFIG_LIB_OSAPI_SYSCLOCK
+    if (timeout_id != 0 && sel4osapi_sysclock_cancel_timeout(timeout_id) != 0)
+    {
+        /* the timeout already expired: consume its signal,
+         * unless it was merged with the one that woke us up */
+        seL4_Poll(waiter.aep, &badge);
+    }
+#endif
+
+    return result;
+}
+
+int
+sel4osapi_semaphore_give(sel4osapi_semaphore_t* sem)
+{
+    sel4osapi_list_t *node = NULL;
+    seL4_CPtr aep = seL4_CapNull;
+
+    assert(sem != NULL);
+
+    if (__atomic_fetch_add(&sem->count, 1, __ATOMIC_SEQ_CST) >= 0)
+    {
+        /* nobody is waiting */
+        return 0;
+    }
+
+    sync_mutex_lock(&sem->lock);
+    node = sel4osapi_list_head_pop(&sem->waiters);
+    if (node != NULL)
+    {
+        /* hand the unit over to the first waiter directly */
+        sel4osapi_semaphore_waiter_t *waiter = (sel4osapi_semaphore_waiter_t *) node->el;
+        waiter->granted = 1;
+        aep = waiter->aep;
+    }
+    else
+    {
+        /* the waiter has not queued up yet: leave the unit for it */
+        sem->grants++;
+    }
+    sync_mutex_unlock(&sem->lock);
+
+    if (aep != seL4_CapNull)
+    {
+        seL4_Signal(aep);
+    }
+
+    return 0;
+}
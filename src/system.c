@@ -157,6 +157,8 @@ sel4osapi_system_bootstrap_root(sel4osapi_system_t *system, void *bootstrap_mem_
     morecore_area = NULL;
     morecore_size = 0;
     syslog_trace("Morecore configured as dynamic, init done!");
+
+    sel4osapi_heap_initialize(&system->vspace, &system->vka);
 }
 
 /*
@@ -215,6 +217,8 @@ sel4osapi_system_bootstrap_user(sel4osapi_system_t *system, void *bootstrap_mem_
     muslc_brk_reservation.res = &muslc_brk_reservation_memory;
     morecore_area = NULL;
     morecore_size = 0;
+
+    sel4osapi_heap_initialize(&system->vspace, &system->vka);
 }
 
 /*
@@ -242,8 +246,10 @@ sel4osapi_system_initialize_root_task_env(sel4osapi_system_t *system)
     system->env->idling_aep = system->idling_aep.capPtr;
 
     syslog_trace("Allocating simple pool for thread... - count=%d, size=%d", SEL4OSAPI_MAX_THREADS_PER_PROCESS, sizeof(sel4osapi_thread_t));
-    system->env->threads = simple_pool_new(SEL4OSAPI_MAX_THREADS_PER_PROCESS, sizeof(sel4osapi_thread_t), NULL, NULL, NULL);
+    system->env->threads = simple_pool_new_lockfree(SEL4OSAPI_MAX_THREADS_PER_PROCESS, sizeof(sel4osapi_thread_t), NULL, NULL);
     assert(system->env->threads);
+    system->env->thread_ids = simple_handle_table_new(SEL4OSAPI_MAX_THREADS_PER_PROCESS);
+    assert(system->env->thread_ids);
 
     syslog_trace("Root task environment successfully initialized");
 }
@@ -259,6 +265,8 @@ sel4osapi_system_initialize_main_thread(sel4osapi_system_t *system)
     snprintf(system->main_thread.info.name,SEL4OSAPI_THREAD_NAME_MAX_LEN,"p-%02d-main", system->env->pid);
     system->main_thread.info.arg = NULL;
     system->main_thread.info.tls = NULL;
+    system->main_thread.info.pool_cache = NULL;
+    memset(system->main_thread.info.sysclock_notifiers, 0, sizeof(system->main_thread.info.sysclock_notifiers));
     system->main_thread.info.tid = 0;
     system->main_thread.info.priority = system->env->priority;
     /*system->main_thread.info.wait_aep = system->wait_aep;*/
@@ -269,6 +277,9 @@ sel4osapi_system_initialize_main_thread(sel4osapi_system_t *system)
         error = vka_alloc_notification(&system->vka, &aep_obj);
         assert(error == 0);
         system->main_thread.info.wait_aep = aep_obj.cptr;
+        error = vka_alloc_notification(&system->vka, &aep_obj);
+        assert(error == 0);
+        system->main_thread.info.sem_aep = aep_obj.cptr;
     }
 
     system->main_thread.info.ipc =  (void*) seL4_GetUserData();
@@ -452,8 +463,10 @@ sel4osapi_system_initialize_process(void *bootstrap_mem_pool, int argc, char **a
     sel4osapi_system_initialize_global_mutex(system);
 
     syslog_trace("Calling simple_pool_new");
-    system->env->threads = simple_pool_new(SEL4OSAPI_MAX_THREADS_PER_PROCESS, sizeof(sel4osapi_thread_t), NULL, NULL, NULL);
+    system->env->threads = simple_pool_new_lockfree(SEL4OSAPI_MAX_THREADS_PER_PROCESS, sizeof(sel4osapi_thread_t), NULL, NULL);
     assert(system->env->threads);
+    system->env->thread_ids = simple_handle_table_new(SEL4OSAPI_MAX_THREADS_PER_PROCESS);
+    assert(system->env->thread_ids);
 
     syslog_trace("Calling system_initialize_main_thread");
     sel4osapi_system_initialize_main_thread(system);
@@ -479,16 +492,31 @@ sel4osapi_system_initialize_process(void *bootstrap_mem_pool, int argc, char **a
         assert(env->udp_iface.mutex);
         env->udp_iface.sockets = simple_pool_new(SEL4OSAPI_UDP_MAX_SOCKETS, sizeof(sel4osapi_udp_socket_t), NULL, NULL, NULL);
         assert(env->udp_iface.sockets);
+        env->udp_iface.socket_ids = simple_handle_table_new(SEL4OSAPI_UDP_MAX_SOCKETS);
+        assert(env->udp_iface.socket_ids);
         assert(env->udp_iface.stack_op_ep);
     }
 #endif
 #ifdef CONFIG_LIB_OSAPI_SERIAL
     syslog_trace("Creating serial semaphore...");
     {
-        assert(env->serial.buf);
-        assert(env->serial.buf_size > 0);
-        env->serial.buf_avail = sel4osapi_semaphore_create(1);
-        assert(env->serial.buf_avail);
+        int i = 0;
+        for (i = 0; i < SEL4OSAPI_SERIAL_PORTS; ++i) {
+            sel4osapi_serialclient_port_t *port = &env->serial.ports[i];
+            if (port->server_ep == seL4_CapNull)
+            {
+                continue;
+            }
+            assert(port->buf);
+            assert(port->buf_size > 0);
+            port->buf_avail = sel4osapi_semaphore_create(1);
+            assert(port->buf_avail);
+            assert(port->ring);
+            port->ring_lock = sel4osapi_mutex_create();
+            assert(port->ring_lock);
+            port->flush_lock = sel4osapi_mutex_create();
+            assert(port->flush_lock);
+        }
     }
 #endif
 
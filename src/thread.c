@@ -88,7 +88,8 @@ sel4osapi_thread_create(
 
     thread = (sel4osapi_thread_t*) simple_pool_alloc(env->threads);
     assert(thread != NULL);
-    tid = simple_pool_get_current_size(env->threads);
+    tid = simple_handle_alloc(env->thread_ids, thread);
+    assert(tid != SIMPLE_HANDLE_INVALID);
 
     error = vka_alloc_endpoint(vka, &thread->local_endpoint);
     assert(error == 0);
@@ -96,6 +97,9 @@ sel4osapi_thread_create(
     error = vka_alloc_notification(vka, &thread->thread_aep);
     assert(error == 0);
 
+    error = vka_alloc_notification(vka, &thread->sem_aep);
+    assert(error == 0);
+
 
     thread->fault_endpoint = env->fault_endpoint;
     // seL4_CapData_t data = seL4_CapData_Guard_new(0, seL4_WordBits - env->cspace_size_bits);
@@ -136,9 +140,12 @@ sel4osapi_thread_create(
         snprintf(thread->info.name,SEL4OSAPI_THREAD_NAME_MAX_LEN,"p-%02d-t-%02d",env->pid, tid);
     }
     thread->info.tls = NULL;
+    thread->info.pool_cache = NULL;
     thread->info.tid = tid;
 
     thread->info.wait_aep = thread->thread_aep.cptr;
+    thread->info.sem_aep = thread->sem_aep.cptr;
+    memset(thread->info.sysclock_notifiers, 0, sizeof(thread->info.sysclock_notifiers));
     thread->info.ipc = (seL4_IPCBuffer*) thread->native.ipc_buffer_addr;
 
     syslog_trace("Thread '%s' (ID=%d) created: TCB=%8p (cptr=%08x), pri=%d", name, thread->info.tid, &thread->native.tcb, thread->native.tcb.cptr, priority);
@@ -165,10 +172,32 @@ sel4osapi_thread_delete(sel4osapi_thread_t *thread)
 {
     vka_t *vka = sel4osapi_system_get_vka();
     vspace_t *vspace = sel4osapi_system_get_vspace();
+    sel4osapi_process_env_t *env = sel4osapi_process_get_current();
+#ifdef CONFIG_LIB_OSAPI_SYSCLOCK
+    int i = 0;
+
+    for (i = 0; i < SEL4OSAPI_THREAD_SYSCLOCK_NOTIFIERS; ++i) {
+        if (thread->info.sysclock_notifiers[i].id != 0)
+        {
+            sel4osapi_sysclock_unregister_notifier(thread->info.sysclock_notifiers[i].id);
+            thread->info.sysclock_notifiers[i].id = 0;
+        }
+    }
+#endif
+    simple_handle_free(env->thread_ids, thread->info.tid);
     vka_free_object(vka, &thread->local_endpoint);
+    vka_free_object(vka, &thread->thread_aep);
+    vka_free_object(vka, &thread->sem_aep);
     sel4utils_clean_up_thread(vka, vspace, &thread->native);
+    simple_pool_free(env->threads, thread);
 }
 
+sel4osapi_thread_t*
+sel4osapi_thread_get(int tid)
+{
+    sel4osapi_process_env_t *env = sel4osapi_process_get_current();
+    return (sel4osapi_thread_t*) simple_handle_lookup(env->thread_ids, tid);
+}
 
 void sel4osapi_thread_routine_wrapper(void *arg1, void *arg2, UNUSED void *ipc_buf) {
     sel4osapi_thread_t *thread = (sel4osapi_thread_t *) arg1;
@@ -181,6 +210,9 @@ void sel4osapi_thread_routine_wrapper(void *arg1, void *arg2, UNUSED void *ipc_b
 
     thread->info.active = 0;
 
+    /* return any element cached by this thread to its pool */
+    simple_pool_flush_thread_cache();
+
     seL4_MessageInfo_t info = seL4_MessageInfo_new(0, 0, 0, 1);
     seL4_SetMR(0, 0);
     seL4_Call(thread->local_endpoint.cptr, info);
@@ -230,3 +262,92 @@ sel4osapi_thread_sleep(uint32_t ms)
     return 0;
 #endif
 }
+
+seL4_Uint32
+sel4osapi_thread_sleep_until(uint32_t deadline_ms)
+{
+#ifdef CONFIG_LIB_OSAPI_SYSCLOCK
+    sel4osapi_thread_info_t *thread = sel4osapi_thread_get_current();
+    seL4_Uint32 now = sel4osapi_sysclock_get_time();
+    seL4_Word timeout_id;
+
+    /* the deadline has already passed: don't queue a timeout for it */
+    if ((int32_t) (now - deadline_ms) >= 0)
+    {
+        return now;
+    }
+
+    timeout_id = sel4osapi_sysclock_schedule_timeout_at(0, deadline_ms, 0, thread->wait_aep);
+    assert(timeout_id != seL4_CapNull);
+    return sel4osapi_sysclock_wait_for_timeout(timeout_id, thread->wait_aep, 0);
+#else
+    syslog_warn("SYSCLOCK not enabled, sel4osapi_thread_sleep_until is not going to do anything!");
+    return 0;
+#endif
+}
+
+#ifdef CONFIG_LIB_OSAPI_SYSCLOCK
+int
+sel4osapi_thread_periodic_start(sel4osapi_thread_periodic_t *periodic, uint32_t start_ms, uint32_t period_ms)
+{
+    sel4osapi_thread_info_t *thread = sel4osapi_thread_get_current();
+
+    assert(periodic != NULL);
+    assert(period_ms > 0);
+
+    periodic->period_ms = period_ms;
+    periodic->next_activation = start_ms;
+    periodic->timeout_id = sel4osapi_sysclock_schedule_timeout_at(1, start_ms, period_ms, thread->wait_aep);
+
+    return (periodic->timeout_id != 0) ? 0 : -1;
+}
+
+uint32_t
+sel4osapi_thread_periodic_wait(sel4osapi_thread_periodic_t *periodic)
+{
+    sel4osapi_thread_info_t *thread = sel4osapi_thread_get_current();
+    uint32_t missed = 0;
+    uint32_t now = 0;
+    seL4_Word badge;
+
+    assert(periodic != NULL);
+    assert(periodic->timeout_id != 0);
+
+    /* the notification does not count signals: compare the
+     * time against the schedule to detect missed activations */
+    now = sel4osapi_sysclock_get_time();
+    if (((int32_t) (now - periodic->next_activation)) >= 0)
+    {
+        /* already due: the signal may have been consumed by a wait
+         * on the same AEP while the thread was busy, otherwise
+         * consume it now so that it does not wake up the next wait */
+        seL4_Poll(thread->wait_aep, &badge);
+    }
+    while (((int32_t) (now - periodic->next_activation)) < 0)
+    {
+        seL4_Wait(thread->wait_aep, &badge);
+        now = sel4osapi_sysclock_get_time();
+    }
+
+    periodic->next_activation += periodic->period_ms;
+    while (((int32_t) (now - periodic->next_activation)) >= 0)
+    {
+        periodic->next_activation += periodic->period_ms;
+        missed++;
+    }
+
+    return missed;
+}
+
+void
+sel4osapi_thread_periodic_stop(sel4osapi_thread_periodic_t *periodic)
+{
+    assert(periodic != NULL);
+
+    if (periodic->timeout_id != 0)
+    {
+        sel4osapi_sysclock_cancel_timeout(periodic->timeout_id);
+        periodic->timeout_id = 0;
+    }
+}
+#endif
@@ -0,0 +1,287 @@
+/*
+ * FILE: timer.c - callback timers for sel4osapi
+ *
+ * Copyright (c) 2015, Real-Time Innovations, Inc. All rights reserved.
+ *
+ * This software may be distributed and modified according to the terms of
+ * the BSD 2-Clause license. Note that NO WARRANTY is provided.
+ * See "LICENSE_BSD2.txt" for details.
+ *
+ */
+
+#include <sel4osapi/osapi.h>
+
+#ifdef CONFIG_LIB_OSAPI_SYSCLOCK
+
+typedef struct sel4osapi_timer_service
+{
+    /*
+     * Protects the heap and the armed timeout
+     */
+    sync_mutex_t lock;
+    sel4osapi_thread_t *thread;
+    /*
+     * AEP the service thread waits on, for both the sysclock's
+     * timeout and the wake ups of threads which start an earlier timer.
+     */
+    seL4_CPtr aep;
+    /*
+     * Min-heap of the scheduled timers, ordered by deadline
+     */
+    sel4osapi_timer_t *timers[SEL4OSAPI_TIMER_SERVICE_MAX_TIMERS];
+    int timers_num;
+    /*
+     * One-shot sysclock timeout armed for the earliest
+     * deadline (0 if none), and its deadline.
+     */
+    seL4_Word timeout_id;
+    uint32_t timeout_deadline;
+} sel4osapi_timer_service_t;
+
+static sel4osapi_timer_service_t sel4osapi_gv_timer_service;
+
+static inline int
+sel4osapi_timer_before(uint32_t t1, uint32_t t2)
+{
+    return ((int32_t) (t1 - t2)) < 0;
+}
+
+static inline void
+sel4osapi_timer_heap_set(sel4osapi_timer_service_t *service, int i, sel4osapi_timer_t *timer)
+{
+    service->timers[i] = timer;
+    timer->index = i;
+}
+
+static void
+sel4osapi_timer_heap_sift_up(sel4osapi_timer_service_t *service, int i)
+{
+    sel4osapi_timer_t *timer = service->timers[i];
+
+    while (i > 0)
+    {
+        int parent = (i - 1) / 2;
+        if (!sel4osapi_timer_before(timer->deadline, service->timers[parent]->deadline))
+        {
+            break;
+        }
+        sel4osapi_timer_heap_set(service, i, service->timers[parent]);
+        i = parent;
+    }
+    sel4osapi_timer_heap_set(service, i, timer);
+}
+
+static void
+sel4osapi_timer_heap_sift_down(sel4osapi_timer_service_t *service, int i)
+{
+    sel4osapi_timer_t *timer = service->timers[i];
+
+    while (1)
+    {
+        int child = 2 * i + 1;
+        if (child >= service->timers_num)
+        {
+            break;
+        }
+        if (child + 1 < service->timers_num &&
+                sel4osapi_timer_before(service->timers[child + 1]->deadline, service->timers[child]->deadline))
+        {
+            child++;
+        }
+        if (!sel4osapi_timer_before(service->timers[child]->deadline, timer->deadline))
+        {
+            break;
+        }
+        sel4osapi_timer_heap_set(service, i, service->timers[child]);
+        i = child;
+    }
+    sel4osapi_timer_heap_set(service, i, timer);
+}
+
+static void
+sel4osapi_timer_heap_remove(sel4osapi_timer_service_t *service, sel4osapi_timer_t *timer)
+{
+    int i = timer->index;
+    sel4osapi_timer_t *last = service->timers[--service->timers_num];
+
+    timer->index = -1;
+    if (last != timer)
+    {
+        sel4osapi_timer_heap_set(service, i, last);
+        sel4osapi_timer_heap_sift_down(service, i);
+        sel4osapi_timer_heap_sift_up(service, last->index);
+    }
+}
+
+/*
+ * Keep a single sysclock timeout armed for the earliest deadline.
+ * Called by the service thread, with the lock held.
+ */
+static void
+sel4osapi_timer_service_arm(sel4osapi_timer_service_t *service, uint32_t now)
+{
+    /* a one-shot timeout which is due has already been released by the sysclock */
+    if (service->timeout_id != 0 && !sel4osapi_timer_before(now, service->timeout_deadline))
+    {
+        service->timeout_id = 0;
+    }
+
+    if (service->timeout_id != 0 &&
+            (service->timers_num == 0 || service->timers[0]->deadline != service->timeout_deadline))
+    {
+        sel4osapi_sysclock_cancel_timeout(service->timeout_id);
+        service->timeout_id = 0;
+    }
+
+    if (service->timeout_id == 0 && service->timers_num > 0)
+    {
+        service->timeout_deadline = service->timers[0]->deadline;
+        service->timeout_id = sel4osapi_sysclock_schedule_timeout_at(0, service->timeout_deadline, 0, service->aep);
+        assert(service->timeout_id != 0);
+    }
+}
+
+static void
+sel4osapi_timer_service_thread(sel4osapi_thread_info_t *thread)
+{
+    sel4osapi_timer_service_t *service = (sel4osapi_timer_service_t *) thread->arg;
+    seL4_Word badge;
+
+    while (thread->active)
+    {
+        uint32_t now = 0;
+
+        sync_mutex_lock(&service->lock);
+        now = sel4osapi_sysclock_get_time();
+
+        /* run the callbacks which are due, earliest first */
+        while (service->timers_num > 0 && !sel4osapi_timer_before(now, service->timers[0]->deadline))
+        {
+            sel4osapi_timer_t *timer = service->timers[0];
+            sel4osapi_timer_callback_fn callback = timer->callback;
+            void *arg = timer->arg;
+
+            if (timer->period_ms > 0)
+            {
+                do
+                {
+                    timer->deadline += timer->period_ms;
+                } while (!sel4osapi_timer_before(now, timer->deadline));
+                sel4osapi_timer_heap_sift_down(service, 0);
+            }
+            else
+            {
+                sel4osapi_timer_heap_remove(service, timer);
+            }
+
+            /* callbacks may start and stop timers */
+            sync_mutex_unlock(&service->lock);
+            callback(arg);
+            sync_mutex_lock(&service->lock);
+            now = sel4osapi_sysclock_get_time();
+        }
+
+        sel4osapi_timer_service_arm(service, now);
+        sync_mutex_unlock(&service->lock);
+
+        seL4_Wait(service->aep, &badge);
+    }
+}
+
+int
+sel4osapi_timer_service_start(int priority)
+{
+    sel4osapi_timer_service_t *service = &sel4osapi_gv_timer_service;
+    int error = 0;
+
+    assert(service->thread == NULL);
+
+    error = sync_mutex_new(sel4osapi_system_get_vka(), &service->lock);
+    assert(error == 0);
+    service->timers_num = 0;
+    service->timeout_id = 0;
+
+    service->thread = sel4osapi_thread_create("timers", sel4osapi_timer_service_thread, service, priority);
+    if (service->thread == NULL)
+    {
+        return -1;
+    }
+    /* known before the thread runs, so that other threads can wake it up */
+    service->aep = service->thread->info.wait_aep;
+
+    return sel4osapi_thread_start(service->thread);
+}
+
+void
+sel4osapi_timer_init(sel4osapi_timer_t *timer, sel4osapi_timer_callback_fn callback, void *arg)
+{
+    assert(timer != NULL);
+    assert(callback != NULL);
+
+    timer->callback = callback;
+    timer->arg = arg;
+    timer->deadline = 0;
+    timer->period_ms = 0;
+    timer->index = -1;
+}
+
+int
+sel4osapi_timer_start(sel4osapi_timer_t *timer, uint32_t delay_ms, uint32_t period_ms)
+{
+    sel4osapi_timer_service_t *service = &sel4osapi_gv_timer_service;
+    int wake_up = 0;
+
+    assert(timer != NULL);
+    assert(service->thread != NULL);
+
+    sync_mutex_lock(&service->lock);
+    if (timer->index < 0)
+    {
+        if (service->timers_num == SEL4OSAPI_TIMER_SERVICE_MAX_TIMERS)
+        {
+            sync_mutex_unlock(&service->lock);
+            return -1;
+        }
+        sel4osapi_timer_heap_set(service, service->timers_num++, timer);
+    }
+    timer->deadline = sel4osapi_sysclock_get_time() + delay_ms;
+    timer->period_ms = period_ms;
+    sel4osapi_timer_heap_sift_down(service, timer->index);
+    sel4osapi_timer_heap_sift_up(service, timer->index);
+
+    /* only the service thread talks to the sysclock: wake it up
+     * if its timeout is no longer armed for the earliest deadline */
+    wake_up = (service->timers[0] == timer) &&
+            (service->timeout_id == 0 || sel4osapi_timer_before(timer->deadline, service->timeout_deadline));
+    sync_mutex_unlock(&service->lock);
+
+    if (wake_up)
+    {
+        seL4_Signal(service->aep);
+    }
+    return 0;
+}
+
+int
+sel4osapi_timer_stop(sel4osapi_timer_t *timer)
+{
+    sel4osapi_timer_service_t *service = &sel4osapi_gv_timer_service;
+    int result = -1;
+
+    assert(timer != NULL);
+    assert(service->thread != NULL);
+
+    /* the service thread cancels its timeout lazily, the next
+     * time it wakes up and finds the heap has changed */
+    sync_mutex_lock(&service->lock);
+    if (timer->index >= 0)
+    {
+        sel4osapi_timer_heap_remove(service, timer);
+        result = 0;
+    }
+    sync_mutex_unlock(&service->lock);
+
+    return result;
+}
+
+#endif
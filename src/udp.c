@@ -28,9 +28,6 @@ udprecv(void *arg, struct udp_pcb *pcb, struct pbuf *p, ip_addr_t *addr, uint16_
     sel4osapi_udp_socket_server_t *server = (sel4osapi_udp_socket_server_t*)arg;
     sel4osapi_udp_message_t *m = NULL;
 
-    int error = sel4osapi_mutex_lock(server->msgs_mutex);
-    assert(!error);
-
     m = simple_pool_alloc(server->msgs);
 
     if (m == NULL) {
@@ -41,9 +38,11 @@ udprecv(void *arg, struct udp_pcb *pcb, struct pbuf *p, ip_addr_t *addr, uint16_
     m->pbuf = p;
     m->addr = *addr;
     m->port = port;
+    m->node.el = m;
+
+    sel4osapi_list_atomic_push(&server->incoming, &m->node);
 
 notify:
-    sel4osapi_mutex_unlock(server->msgs_mutex);
     seL4_SetMR(0, 1);
     seL4_Send(server->socket.aep_rx_data, msg);
 }
@@ -132,19 +131,26 @@ sel4osapi_udp_socket_rx_thread(sel4osapi_thread_info_t *thread)
         /* wait for client to be ready to receive */
         minfo = seL4_Recv(server->socket.ep_rx_ready, &sender_badge);
 
-        error = sel4osapi_mutex_lock(server->msgs_mutex);
-        assert(!error);
-        if (server->msgs->entries == NULL)
+        if (server->pending.head == NULL)
+        {
+            /* the newest message comes first: prepend them all */
+            sel4osapi_list_t *node = sel4osapi_list_atomic_take(&server->incoming);
+            while (node != NULL)
+            {
+                sel4osapi_list_t *next = node->next;
+                sel4osapi_list_head_prepend(&server->pending, node);
+                node = next;
+            }
+        }
+        if (server->pending.head == NULL)
         {
             syslog_warn("awaken without messages.");
-            sel4osapi_mutex_unlock(server->msgs_mutex);
             goto reply;
         }
-        msg = (sel4osapi_udp_message_t*) server->msgs->entries->el;
+        msg = (sel4osapi_udp_message_t*) sel4osapi_list_head_pop(&server->pending)->el;
         remaining_msgs = simple_pool_get_current_size(server->msgs);
         assert(msg);
         assert(msg->pbuf);
-        sel4osapi_mutex_unlock(server->msgs_mutex);
 
         total_msgs++;
 
@@ -184,12 +190,9 @@ reply:
 #endif
             sel4osapi_mutex_unlock(server->iface->mutex);
 
-            /* return msg to pool */
-            error = sel4osapi_mutex_lock(server->msgs_mutex);
-            assert(!error);
+            /* return msg to pool (lock-free) */
             error = simple_pool_free(server->msgs, msg);
             assert(error == 0);
-            sel4osapi_mutex_unlock(server->msgs_mutex);
 
             msg = NULL;
         }
@@ -254,34 +257,19 @@ sel4osapi_udp_stack_thread(sel4osapi_thread_info_t *thread)
 
                 syslog_trace("create socket request: client=%d, add=%s", client_id, ipaddr_ntoa(&addr));
 
-                {
-                    sel4osapi_list_t *cursor;
-                    sel4osapi_ipcclient_t *ncursor;
-
-                    cursor = net->ipc->clients->entries;
-                    while (cursor != NULL)
-                    {
-                        ncursor = (sel4osapi_ipcclient_t*) cursor->el;
-                        if (ncursor->id == client_id)
-                        {
-                            client = ncursor;
-                            break;
-                        }
-                        cursor = cursor->next;
-                    }
-                    assert(client != NULL);
-                }
+                client = sel4osapi_ipc_get_client(net->ipc, client_id);
+                assert(client != NULL);
 
                 {
                     sel4osapi_list_t *cursor, *cursor2;
                     sel4osapi_netiface_t *ncursor;
                     sel4osapi_netvface_t *vcursor;
 
-                    cursor = net->ifaces->entries;
+                    cursor = net->ifaces->entries.head;
                     while (cursor != NULL)
                     {
                         ncursor = (sel4osapi_netiface_t*) cursor->el;
-                        cursor2 = ncursor->vfaces->entries;
+                        cursor2 = ncursor->vfaces->entries.head;
                         while (cursor2 != NULL)
                         {
                             vcursor = (sel4osapi_netvface_t*) cursor2->el;
@@ -304,7 +292,8 @@ sel4osapi_udp_stack_thread(sel4osapi_thread_info_t *thread)
                 socket_server->client = client;
                 socket_server->udp_pcb = udp_new();
                 assert(socket_server->udp_pcb);
-                socket_server->socket.id = simple_pool_get_current_size(udp->socket_servers);
+                socket_server->socket.id = simple_handle_alloc(udp->socket_ids, socket_server);
+                assert(socket_server->socket.id != SIMPLE_HANDLE_INVALID);
                 socket_server->socket.addr = addr;
 
                 socket_server->socket.port = 0;
@@ -319,8 +308,9 @@ sel4osapi_udp_stack_thread(sel4osapi_thread_info_t *thread)
                 assert(socket_server->tx_thread);
 
                 socket_server->rx_thread = NULL;
-                socket_server->msgs_mutex = NULL;
                 socket_server->msgs = NULL;
+                socket_server->incoming = NULL;
+                sel4osapi_list_head_init(&socket_server->pending);
 
                 vka_cspace_alloc(vka, &tx_ready_ep_mint);
                 assert(tx_ready_ep_mint != seL4_CapNull);
@@ -357,33 +347,19 @@ sel4osapi_udp_stack_thread(sel4osapi_thread_info_t *thread)
 
                 syslog_trace("bind socket request: socket=%d, port=%d", socket_id, bind_port);
 
-                {
-                    sel4osapi_list_t *cursor;
-                    sel4osapi_udp_socket_server_t *scursor;
-
-                    cursor = udp->socket_servers->entries;
-                    while (cursor != NULL)
-                    {
-                        scursor = (sel4osapi_udp_socket_server_t*) cursor->el;
-                        if (scursor->socket.id == socket_id)
-                        {
-                            socket_server = scursor;
-                            break;
-                        }
-                        cursor = cursor->next;
-                    }
-                    assert(socket_server != NULL);
-                }
+                socket_server = simple_handle_lookup(udp->socket_ids, socket_id);
+                assert(socket_server != NULL);
 
                 assert(socket_server->socket.port == 0);
 
-                socket_server->msgs = simple_pool_new(SEL4OSAPI_UDP_MAX_MSGS_PER_CLIENT, sizeof(sel4osapi_udp_message_t), NULL, NULL, NULL);
+                socket_server->msgs = simple_pool_new_lockfree(SEL4OSAPI_UDP_MSGS_CHUNK_SIZE, sizeof(sel4osapi_udp_message_t), NULL, NULL);
                 assert(socket_server->msgs);
-                syslog_trace("UDP receive pool size: %d",
-                        SEL4OSAPI_UDP_MAX_MSGS_PER_CLIENT);
+                simple_pool_set_growth(socket_server->msgs, SEL4OSAPI_UDP_MAX_MSGS_PER_CLIENT, NULL, NULL);
+                syslog_trace("UDP receive pool size: %d (max %d)",
+                        SEL4OSAPI_UDP_MSGS_CHUNK_SIZE, SEL4OSAPI_UDP_MAX_MSGS_PER_CLIENT);
 
-                socket_server->msgs_mutex = sel4osapi_mutex_create();
-                assert(socket_server->msgs_mutex);
+                socket_server->incoming = NULL;
+                sel4osapi_list_head_init(&socket_server->pending);
 
                 snprintf(thread_name, SEL4OSAPI_THREAD_NAME_MAX_LEN, "udp-%d-rx", socket_server->socket.id);
                 socket_server->rx_thread = sel4osapi_thread_create(thread_name, sel4osapi_udp_socket_rx_thread, socket_server, thread->priority);
@@ -472,6 +448,9 @@ sel4osapi_udp_initialize(sel4osapi_udpstack_t *udp, int priority)
     udp->socket_servers = simple_pool_new(SEL4OSAPI_UDP_MAX_SOCKETS, sizeof(sel4osapi_udp_socket_server_t), NULL, NULL, NULL);
     assert(udp->socket_servers);
 
+    udp->socket_ids = simple_handle_table_new(SEL4OSAPI_UDP_MAX_SOCKETS);
+    assert(udp->socket_ids);
+
     error = vka_alloc_endpoint(vka, &ep_obj);
     assert(error == 0);
     udp->stack_op_ep = ep_obj.cptr;
@@ -531,6 +510,8 @@ sel4osapi_udp_create_socket(ip_addr_t *addr)
     error = mr0;
     socket->id = mr1;
     assert(error == 0);
+    error = simple_handle_insert(udp_iface->socket_ids, socket->id, socket);
+    assert(error == 0);
 
     /* reset receive cap path */
     seL4_SetCapReceivePath(seL4_CapNull,seL4_CapNull,seL4_CapNull);
@@ -610,7 +591,7 @@ sel4osapi_udp_send(sel4osapi_udp_socket_t *socket, void *msg, size_t len, ip_add
 
     assert(socket);
 
-    sel4osapi_semaphore_take(client->tx_buf_avail, 0);
+    sel4osapi_semaphore_take(client->tx_buf_avail, SEL4OSAPI_WAIT_FOREVER);
 
     memcpy(client->tx_buf, msg, len);
 
@@ -658,7 +639,7 @@ sel4osapi_udp_recv(sel4osapi_udp_socket_t *socket, void *msg, unsigned int max_l
     minfo = seL4_Recv(socket->aep_rx_data, &sender_badge);
     /* a message was received on the socket,
      * take lock on rx_buf */
-    sel4osapi_semaphore_take(client->rx_buf_avail, 0);
+    sel4osapi_semaphore_take(client->rx_buf_avail, SEL4OSAPI_WAIT_FOREVER);
 
     /* notify rx server to copy msg to rx_buf */
     minfo = seL4_MessageInfo_new(0,0,0,0);
@@ -709,22 +690,11 @@ sel4osapi_udp_sd_to_socket(int sd)
     sel4osapi_process_env_t *process = sel4osapi_process_get_current();
     sel4osapi_udp_interface_t *udp_iface = &process->udp_iface;
     sel4osapi_udp_socket_t *socket = NULL;
-    sel4osapi_list_t *cursor = NULL;
 
     assert(sd > 0);
 
     sel4osapi_mutex_lock(udp_iface->mutex);
-    cursor = udp_iface->sockets->entries;
-    while(cursor != NULL)
-    {
-        socket = (sel4osapi_udp_socket_t*) cursor->el;
-        if (socket->id == sd)
-        {
-            break;
-        }
-        socket = NULL;
-        cursor = cursor->next;
-    }
+    socket = simple_handle_lookup(udp_iface->socket_ids, sd);
     assert(socket);
     sel4osapi_mutex_unlock(udp_iface->mutex);
     return socket;